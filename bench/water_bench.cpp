@@ -0,0 +1,613 @@
+/// Micro benchmarks, build with CMAKE_BUILD_TYPE=Release and run "water_bench [NAME_FILTER]"
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <fmt/core.h>
+#include <new>
+#include <span>
+#include <string>
+#include <thread>
+#include <type_traits>
+#include <unordered_set>
+#include <vector>
+
+#include "astar.h"
+#include "flat_set.h"
+#include "hash.h"
+#include "level_bitmap.h"
+#include "solver.h"
+#include "successors.h"
+
+namespace {
+std::atomic<size_t> g_allocations{0}; // Count of operator new calls, relaxed, bench_parallel allocates on its threads
+} // namespace
+
+// The replacements pair malloc and free, GCC can not tell once they are inlined into the standard containers
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wmismatched-new-delete"
+
+void *operator new(size_t size) {
+    g_allocations.fetch_add(1, std::memory_order_relaxed);
+    if (void *ptr = malloc(size)) { // NOLINT(cppcoreguidelines-no-malloc)
+        return ptr;
+    }
+    throw std::bad_alloc();
+}
+
+void operator delete(void *ptr) noexcept {
+    free(ptr); // NOLINT(cppcoreguidelines-no-malloc)
+}
+
+void operator delete(void *ptr, size_t /*size*/) noexcept {
+    free(ptr); // NOLINT(cppcoreguidelines-no-malloc)
+}
+
+#pragma GCC diagnostic pop
+
+namespace {
+
+/// Measure the wall clock time of a call in seconds
+template <typename Func>
+double seconds(Func &&func) {
+    const auto start = std::chrono::steady_clock::now();
+    func();
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+/// Prevent the compiler from optimizing away a result
+template <typename T>
+void keep(const T &value) {
+    asm volatile("" : : "g"(&value) : "memory");
+}
+
+const std::array BENCH_VOLUMES{VesselsState{3, 5, 8}, VesselsState{100, 171, 222}, VesselsState{300, 500, 801},
+                               VesselsState{1000, 1201, 1999}};
+
+/// The pre-InlineVector API: a heap allocated vector per expanded state
+std::vector<VesselsState> next_states_vector(const VesselsState &state, const VesselsState &volumes) {
+    std::vector<VesselsState> result;
+    result.reserve(12);
+    for (const VesselsState next : state.next_states(volumes)) {
+        result.push_back(next);
+    }
+    result.shrink_to_fit();
+    return result;
+}
+
+/// Expand every state on the box surface once, count the heap allocations per expanded state
+void bench_next_states() {
+    fmt::print("{:>18} {:>10} {:>12} {:>12} {:>12} {:>12}\n", "volumes", "states", "vector ns", "vector alloc",
+               "inline ns", "inline alloc");
+    for (const VesselsState &volumes : BENCH_VOLUMES) {
+        const uint64_t states = volumes.surface_size();
+        size_t successors = 0;
+
+        size_t allocations = g_allocations;
+        const double vector_time = seconds([&] {
+            for (uint64_t rank = 0; rank < states; ++rank) {
+                successors += next_states_vector(VesselsState::surface_unrank(rank, volumes), volumes).size();
+            }
+        });
+        const size_t vector_allocations = g_allocations - allocations;
+
+        allocations = g_allocations;
+        const double inline_time = seconds([&] {
+            for (uint64_t rank = 0; rank < states; ++rank) {
+                successors += VesselsState::surface_unrank(rank, volumes).next_states(volumes).size();
+            }
+        });
+        const size_t inline_allocations = g_allocations - allocations;
+        keep(successors);
+
+        const auto per_state = [states](double value) { return value / static_cast<double>(states); };
+        fmt::print("{:>5} {:>5} {:>5} {:>10} {:>12.1f} {:>12.2f} {:>12.1f} {:>12.2f}\n", volumes[0], volumes[1],
+                   volumes[2], states, per_state(vector_time) * 1e9, per_state(double(vector_allocations)),
+                   per_state(inline_time) * 1e9, per_state(double(inline_allocations)));
+    }
+}
+
+/// Expand every state on the box surface once and test the successors for a target, one state at a time vs in
+/// batches of SuccessorBatch::SIZE
+void bench_successors() {
+    fmt::print("{:>18} {:>10} {:>12} {:>12} {:>8}\n", "volumes", "states", "inline ns", "batch ns", "goals");
+    for (const VesselsState &volumes : BENCH_VOLUMES) {
+        const uint64_t states = volumes.surface_size();
+        const auto target = static_cast<water>(volumes[2] / 2 + 1);
+        size_t inline_goals = 0;
+        size_t inline_sum = 0;
+        const double inline_time = seconds([&] {
+            for (uint64_t rank = 0; rank < states; ++rank) {
+                const VesselsState state = VesselsState::surface_unrank(rank, volumes);
+                for (const VesselsState::Transition next : state.next_moves(volumes)) {
+                    inline_sum += next.state[0] + static_cast<size_t>(next.move);
+                    inline_goals += next.state.contains(target) ? 1 : 0;
+                }
+            }
+        });
+        size_t batch_goals = 0;
+        size_t batch_sum = 0;
+        SuccessorBatch batch;
+        const double batch_time = seconds([&] {
+            for (uint64_t rank = 0; rank < states; rank += SuccessorBatch::SIZE) {
+                batch.clear();
+                for (uint64_t idx = rank; idx != std::min(states, rank + SuccessorBatch::SIZE); ++idx) {
+                    batch.push_back(VesselsState::surface_unrank(idx, volumes));
+                }
+                batch.expand(volumes, target);
+                const unsigned first_goal = batch.first_goal();
+                for (unsigned lane = 0; lane != batch.size(); ++lane) {
+                    for (unsigned order = 0; order != MOVES_COUNT; ++order) {
+                        const Move move = SuccessorBatch::ORDER[order];
+                        if (batch.valid(move, lane)) {
+                            batch_sum += batch.state(move, lane)[0] + static_cast<size_t>(move);
+                            batch_goals += lane * MOVES_COUNT + order >= first_goal && batch.goal(move, lane) ? 1 : 0;
+                        }
+                    }
+                }
+            }
+        });
+        keep(inline_sum);
+        keep(batch_sum);
+
+        const auto per_state = [states](double value) { return value / static_cast<double>(states) * 1e9; };
+        fmt::print("{:>5} {:>5} {:>5} {:>10} {:>12.1f} {:>12.1f} {:>8}{}\n", volumes[0], volumes[1], volumes[2], states,
+                   per_state(inline_time), per_state(batch_time), batch_goals,
+                   inline_sum == batch_sum && inline_goals == batch_goals ? "" : " DIFFERENT");
+    }
+}
+
+/// Insert the successors of every state on the box surface, std::unordered_set vs FlatStateSet, both reserved for all
+/// the surface states, then the whole search with the sparse layout
+void bench_flat_set() {
+    fmt::print("{:>18} {:>10} {:>12} {:>12} {:>12} {:>12} {:>14}\n", "volumes", "states", "unordered ns", "flat ns",
+               "unordered MB", "flat MB", "sparse solve ns");
+    for (const VesselsState &volumes : BENCH_VOLUMES) {
+        const uint64_t states = volumes.surface_size();
+        const auto insert_all = [&](auto &&insert) {
+            size_t inserted = 0;
+            for (uint64_t rank = 0; rank < states; ++rank) {
+                for (const VesselsState next : VesselsState::surface_unrank(rank, volumes).next_states(volumes)) {
+                    inserted += insert(next) ? 1 : 0;
+                }
+            }
+            return inserted;
+        };
+
+        size_t allocations = g_allocations;
+        std::unordered_set<VesselsState, VesselsState> unordered;
+        unordered.reserve(states);
+        size_t unordered_count = 0;
+        const double unordered_time = seconds([&] {
+            unordered_count = insert_all([&](const VesselsState &state) { return unordered.insert(state).second; });
+        });
+        // A node per element with the cached hash and the next pointer, plus the bucket array
+        const double unordered_bytes =
+            double(g_allocations - allocations) * (sizeof(VesselsState) + 2 * sizeof(void *)) +
+            double(unordered.bucket_count() * sizeof(void *));
+        unordered = {};
+
+        FlatStateSet<> flat;
+        flat.reserve(states);
+        size_t flat_count = 0;
+        const double flat_time = seconds([&] {
+            flat_count = insert_all([&](const VesselsState &state) { return flat.insert(state); });
+        });
+        const double flat_bytes = double(std::bit_ceil(states * 2) * sizeof(uint64_t));
+        flat = {};
+
+        WaterPouringPuzzleSolver solver{volumes, Layout::sparse};
+        const double solve_time = seconds([&] { solver.solve_all(); });
+
+        const auto per_state = [states](double value) { return value / static_cast<double>(states) * 1e9; };
+        fmt::print("{:>5} {:>5} {:>5} {:>10} {:>12.1f} {:>12.1f} {:>12.1f} {:>12.1f} {:>14.1f}{}\n", volumes[0],
+                   volumes[1], volumes[2], states, per_state(unordered_time), per_state(flat_time),
+                   unordered_bytes / 1e6, flat_bytes / 1e6,
+                   solve_time / static_cast<double>(solver.discovered()) * 1e9,
+                   unordered_count == flat_count ? "" : " DIFFERENT");
+    }
+}
+
+/// Collision rate, mean probe length and insert time of the hash policies for all the surface states, in
+/// std::unordered_set (the states sharing a bucket, the bucket sizes a lookup walks) and in FlatStateSet (the states
+/// not in their home slot, the slots a lookup reads). Then the whole search with the sparse layout.
+template <typename Hash>
+void bench_hash_policy(const char *name, const VesselsState &volumes) {
+    // The low bits of the packed state are the first vessel's, the flat set probes through whole clusters of them
+    constexpr uint64_t PACK_FLAT_LIMIT = 1U << 16;
+    const uint64_t states = volumes.surface_size();
+    std::unordered_set<VesselsState, Hash> unordered;
+    unordered.reserve(states);
+    const double unordered_time = seconds([&] {
+        for (uint64_t rank = 0; rank < states; ++rank) {
+            unordered.insert(VesselsState::surface_unrank(rank, volumes));
+        }
+    });
+    size_t shared = 0;
+    size_t walked = 0;
+    for (size_t bucket = 0; bucket != unordered.bucket_count(); ++bucket) {
+        const size_t size = unordered.bucket_size(bucket);
+        shared += size > 1 ? size : 0;
+        walked += size * (size + 1) / 2;
+    }
+    unordered = {};
+    const auto per_state = [states](double value) { return value / static_cast<double>(states); };
+    fmt::print("{:>5} {:>5} {:>5} {:>6} {:>10.3f} {:>8.2f} {:>8.1f}", volumes[0], volumes[1], volumes[2], name,
+               per_state(double(shared)), per_state(double(walked)), per_state(unordered_time) * 1e9);
+    if (std::is_same_v<Hash, PackHash> && states > PACK_FLAT_LIMIT) {
+        fmt::print(" {:>10} {:>8} {:>8} {:>10}\n", "-", "-", "-", "-");
+        return;
+    }
+
+    FlatStateSet<VesselsState, Hash> flat;
+    flat.reserve(states);
+    const double flat_time = seconds([&] {
+        for (uint64_t rank = 0; rank < states; ++rank) {
+            flat.insert(VesselsState::surface_unrank(rank, volumes));
+        }
+    });
+
+    BasicWaterPouringPuzzleSolver<3, water, Hash> solver{volumes, Layout::sparse};
+    const double solve_time = seconds([&] { solver.solve_all(); });
+
+    fmt::print(" {:>10.3f} {:>8.2f} {:>8.1f} {:>10.1f}\n", flat.collision_rate(), flat.mean_probe(),
+               per_state(flat_time) * 1e9, solve_time / static_cast<double>(solver.discovered()) * 1e9);
+}
+
+void bench_hash() {
+    fmt::print("{:>18} {:>6} {:>10} {:>8} {:>8} {:>10} {:>8} {:>8} {:>10}\n", "volumes", "hash", "unord coll",
+               "probe", "ns", "flat coll", "probe", "ns", "solve ns");
+    for (const VesselsState &volumes :
+         {VesselsState{3, 5, 8}, VesselsState{30, 41, 53}, VesselsState{100, 171, 222}, VesselsState{300, 500, 801}}) {
+        bench_hash_policy<PackHash>("pack", volumes);
+        bench_hash_policy<MixHash>("mix", volumes);
+        bench_hash_policy<CrcHash>("crc", volumes);
+    }
+}
+
+/// Explore the whole reachable space with the solver
+void bench_solve() {
+    fmt::print("{:>18} {:>10} {:>12} {:>12}\n", "volumes", "states", "ns/state", "alloc/state");
+    for (const VesselsState &volumes : BENCH_VOLUMES) {
+        WaterPouringPuzzleSolver solver{volumes};
+        const size_t allocations = g_allocations;
+        const double time = seconds([&] { solver.solve_all(); });
+        const auto states = static_cast<double>(solver.discovered());
+        fmt::print("{:>5} {:>5} {:>5} {:>10} {:>12.1f} {:>12.6f}\n", volumes[0], volumes[1], volumes[2],
+                   solver.discovered(), time / states * 1e9, double(g_allocations - allocations) / states);
+    }
+}
+
+/// Path tracking by parent indices vs move codes, the memory is what the tracking needs at the end of the search
+void bench_tracking() {
+    struct Case {
+        VesselsState volumes;
+        water target;
+    };
+    const std::array cases{Case{{100, 171, 222}, 101}, Case{{300, 500, 801}, 651}, Case{{1000, 1201, 1999}, 1998}};
+
+    fmt::print("{:>24} {:>6} {:>8} {:>10} {:>10} {:>12} {:>10}\n", "volumes target", "steps", "tracking", "solve ms",
+               "path ms", "discovered", "bytes");
+    for (const Case &test : cases) {
+        for (const Tracking tracking : {Tracking::parents, Tracking::moves, Tracking::frontier, Tracking::depths}) {
+            WaterPouringPuzzleSolver solver{test.volumes, Layout::automatic, tracking};
+            int steps = 0;
+            const double solve_time = seconds([&] { steps = solver.solve(test.target); });
+            size_t length = 0;
+            const double path_time = seconds([&] { length = solver.path().size(); });
+            keep(length);
+            // History entry of 6 + 4 bytes per discovered state vs 2 bytes per state of the box surface vs nothing but
+            // the widest BFS levels, not counted, vs 2 bits per state of the surface
+            const std::array bytes{solver.discovered() * 10, test.volumes.surface_size() * 2, size_t(0),
+                                   (test.volumes.surface_size() + 3) / 4};
+            const std::array names{"parents", "moves", "frontier", "depths"};
+            fmt::print("{:>5} {:>5} {:>5} {:>6} {:>6} {:>8} {:>10.2f} {:>10.2f} {:>12} {:>10}\n", test.volumes[0],
+                       test.volumes[1], test.volumes[2], test.target, steps, names[static_cast<size_t>(tracking)],
+                       solve_time * 1e3, path_time * 1e3, solver.discovered(), bytes[static_cast<size_t>(tracking)]);
+        }
+    }
+}
+
+/// Many targets for the same volumes, a new solver per query vs one solver resuming its search
+void bench_queries() {
+    constexpr size_t QUERIES = 16;
+    fmt::print("{:>18} {:>8} {:>12} {:>12} {:>12}\n", "volumes", "queries", "fresh ms", "reused ms", "discovered");
+    for (const VesselsState &volumes : std::span(BENCH_VOLUMES).first(3)) {
+        std::array<water, QUERIES> targets{};
+        for (size_t i = 0; i < QUERIES; ++i) { // Spread over all the amounts, the biggest ones last
+            targets.at(i) = static_cast<water>(1 + volumes[2] * i / QUERIES);
+        }
+
+        int fresh_steps = 0;
+        const double fresh_time = seconds([&] {
+            for (const water target : targets) {
+                WaterPouringPuzzleSolver solver{volumes};
+                fresh_steps += solver.solve(target);
+            }
+        });
+        int reused_steps = 0;
+        WaterPouringPuzzleSolver solver{volumes};
+        const double reused_time = seconds([&] {
+            for (const water target : targets) {
+                reused_steps += solver.solve(target);
+            }
+        });
+        if (fresh_steps != reused_steps) {
+            fmt::print("Different answers: {} vs {} total steps!\n", fresh_steps, reused_steps);
+        }
+        fmt::print("{:>5} {:>5} {:>5} {:>8} {:>12.2f} {:>12.2f} {:>12}\n", volumes[0], volumes[1], volumes[2], QUERIES,
+                   fresh_time * 1e3, reused_time * 1e3, solver.discovered());
+    }
+}
+
+/// Explore the whole reachable space with the parallel engine, the speedup over one thread
+void bench_parallel() {
+    const unsigned cores = std::max(std::thread::hardware_concurrency(), 1U);
+    std::vector<unsigned> counts{1, 2, 4};
+    if (cores > counts.back()) {
+        counts.push_back(cores);
+    }
+    fmt::print("{} cores\n{:>18} {:>8} {:>12} {:>10} {:>8}\n", cores, "volumes", "threads", "discovered", "ms",
+               "speedup");
+    for (const VesselsState &volumes : std::span(BENCH_VOLUMES).last(2)) {
+        double serial_time = 0;
+        for (const unsigned threads : counts) {
+            WaterPouringPuzzleSolver solver{volumes, Layout::automatic, Tracking::parents, threads};
+            const double time = seconds([&] { solver.solve_all(); });
+            serial_time = threads == 1 ? time : serial_time;
+            fmt::print("{:>5} {:>5} {:>5} {:>8} {:>12} {:>10.1f} {:>8.2f}\n", volumes[0], volumes[1], volumes[2],
+                       threads, solver.discovered(), time * 1e3, serial_time / time);
+        }
+    }
+}
+
+/// Targets the feasibility oracle rejects without a search vs the full search they used to cost
+void bench_oracle() {
+    struct Case {
+        const char *name;
+        VesselsState volumes;
+        water target;
+    };
+    const std::array cases{Case{"too much", {1000, 1201, 1999}, 2000},
+                           Case{"divisor", {2000, 2402, 3998}, 1001}, // Odd
+                           Case{"one vessel", {0, 0, 1999}, 1999}};
+    constexpr int REPEAT = 100000;
+
+    fmt::print("{:>12} {:>24} {:>10} {:>10} {:>10}\n", "case", "volumes target", "oracle ns", "alloc", "search ms");
+    for (const Case &test : cases) {
+        int steps = 0;
+        const size_t allocations = g_allocations;
+        const double oracle_time = seconds([&] {
+            for (int i = 0; i != REPEAT; ++i) {
+                WaterPouringPuzzleSolver solver{test.volumes};
+                steps += solver.solve(test.target);
+            }
+        });
+        const size_t oracle_allocations = g_allocations - allocations;
+        keep(steps);
+
+        WaterPouringPuzzleSolver solver{test.volumes};
+        const double search_time = seconds([&] { solver.solve_all(); });
+        fmt::print("{:>12} {:>5} {:>5} {:>5} {:>6} {:>10.1f} {:>10} {:>10.2f}\n", test.name, test.volumes[0],
+                   test.volumes[1], test.volumes[2], test.target, oracle_time / REPEAT * 1e9, oracle_allocations,
+                   search_time * 1e3);
+    }
+}
+
+/// Big instances the pour and refill strategy solves when proven minimal vs the full search
+void bench_analytic() {
+    struct Case {
+        VesselsState volumes;
+        water target;
+    };
+    const std::array cases{Case{{0, 30011, 65521}, 1}, Case{{30000, 50000, 65535}, 20000},
+                           Case{{1000, 1201, 1999}, 1998}};
+    constexpr uint64_t FULL_LIMIT = uint64_t(1) << 28;
+
+    fmt::print("{:>24} {:>12} {:>8} {:>12} {:>12} {:>14}\n", "volumes target", "steps", "minimal", "analytic ms",
+               "solve ms", "full search ms");
+    for (const Case &test : cases) {
+        PourAndRefill::Result analytic{};
+        size_t length = 0;
+        const double analytic_time = seconds([&] {
+            analytic = PourAndRefill::solve(test.volumes, test.target);
+            length = analytic.steps < 0 ? 0 : PourAndRefill::path(test.volumes, test.target, analytic).size();
+        });
+        keep(length);
+        int steps = 0;
+        WaterPouringPuzzleSolver solver{test.volumes};
+        const double solve_time = seconds([&] { steps = solver.solve(test.target); });
+        std::string search_ms = "too big"; // Gigabytes of history
+        if (test.volumes.divided(WaterPouringPuzzleSolver::common_divisor(test.volumes)).surface_size() < FULL_LIMIT) {
+            WaterPouringPuzzleSolver search{test.volumes};
+            search_ms = fmt::format("{:.1f}", seconds([&] { search.solve_all(); }) * 1e3);
+        }
+        fmt::print("{:>5} {:>5} {:>5} {:>6} {:>12} {:>8} {:>12.3f} {:>12.3f} {:>14}\n", test.volumes[0],
+                   test.volumes[1], test.volumes[2], test.target, fmt::format("{}/{}", analytic.steps, steps),
+                   analytic.minimal ? "yes" : "no", analytic_time * 1e3, solve_time * 1e3, search_ms);
+    }
+}
+
+/// Targets the best vessel pairing measures in the minimal step count, the search stops before that level
+void bench_bound() {
+    struct Case {
+        VesselsState volumes;
+        water target;
+    };
+    const std::array cases{Case{{300, 500, 801}, 751}, Case{{1000, 1201, 1999}, 299}, Case{{1000, 1201, 1999}, 1500}};
+
+    fmt::print("{:>24} {:>8} {:>8} {:>12} {:>10} {:>12}\n", "volumes target", "bound", "steps", "discovered", "ms",
+               "reachable");
+    for (const Case &test : cases) {
+        const PourAndRefill::Result analytic = PourAndRefill::solve(test.volumes, test.target);
+        WaterPouringPuzzleSolver solver{test.volumes};
+        int steps = 0;
+        const double time = seconds([&] { steps = solver.solve(test.target); });
+        WaterPouringPuzzleSolver all{test.volumes};
+        all.solve_all();
+        fmt::print("{:>5} {:>5} {:>5} {:>6} {:>8} {:>8} {:>12} {:>10.1f} {:>12}\n", test.volumes[0], test.volumes[1],
+                   test.volumes[2], test.target, analytic.steps, steps, solver.discovered(), time * 1e3,
+                   all.discovered());
+    }
+}
+
+/// A* vs the breadth first search of a fresh solver, the states each one touches before the goal
+void bench_astar() {
+    struct Case {
+        VesselsState volumes;
+        water target;
+    };
+    const std::array cases{Case{{3, 5, 8}, 4}, Case{{100, 171, 222}, 1}, Case{{300, 500, 801}, 751},
+                           Case{{1000, 1201, 1999}, 299}, Case{{1000, 1201, 1999}, 1998}};
+
+    fmt::print("{:>24} {:>6} {:>12} {:>8} {:>12} {:>12} {:>8} {:>10} {:>10}\n", "volumes target", "steps", "bfs disc.",
+               "bfs ms", "a* expanded", "a* disc.", "a* ms", "array ms", "reduction");
+    for (const Case &test : cases) {
+        WaterPouringPuzzleSolver bfs{test.volumes};
+        int bfs_steps = 0;
+        const double bfs_time = seconds([&] { bfs_steps = bfs.solve(test.target); });
+        AStarSolver astar{test.volumes};
+        int steps = 0;
+        const double astar_time = seconds([&] { steps = astar.solve(test.target); });
+        BasicAStarSolver<VesselsState> array{test.volumes}; // The same search on the levels in an array
+        int array_steps = 0;
+        const double array_time = seconds([&] { array_steps = array.solve(test.target); });
+        fmt::print("{:>5} {:>5} {:>5} {:>6} {:>6} {:>12} {:>8.2f} {:>12} {:>12} {:>8.2f} {:>10.2f} {:>9.1f}%\n",
+                   test.volumes[0], test.volumes[1], test.volumes[2], test.target,
+                   steps == bfs_steps && steps == array_steps ? fmt::format("{}", steps) : "DIFF", bfs.discovered(),
+                   bfs_time * 1e3, astar.expanded(), astar.discovered(), astar_time * 1e3, array_time * 1e3,
+                   100.0 * (1.0 - static_cast<double>(astar.expanded()) / static_cast<double>(bfs.discovered())));
+    }
+}
+
+/// All the targets by the level bitmaps vs the per state search
+void bench_bitmap() {
+    fmt::print("{:>18} {:>10} {:>10} {:>12} {:>10}\n", "volumes", "states", "search ms", "bitmap ms", "same");
+    for (const VesselsState &volumes : {VesselsState{3, 5, 8}, VesselsState{100, 171, 222}, VesselsState{300, 500, 801},
+                                        VesselsState{60, 997, 1000}}) {
+        if (!LevelBitmapSolver::fits(volumes)) {
+            continue;
+        }
+        WaterPouringPuzzleSolver search{volumes};
+        const double search_time = seconds([&] { search.solve_all(); });
+        LevelBitmapSolver bitmap{volumes};
+        const double bitmap_time = seconds([&] { bitmap.solve_all(); });
+        bool same = search.discovered() == bitmap.discovered();
+        for (size_t amount = 0; amount <= *std::max_element(volumes.begin(), volumes.end()); ++amount) {
+            same = same && search.solution(static_cast<water>(amount)).steps ==
+                               bitmap.solution(static_cast<water>(amount)).steps;
+        }
+        fmt::print("{:>5} {:>5} {:>6} {:>10} {:>10.1f} {:>12.1f} {:>10}\n", volumes[0], volumes[1], volumes[2],
+                   bitmap.discovered(), search_time * 1e3, bitmap_time * 1e3, same ? "yes" : "NO");
+    }
+}
+
+/// The whole search of an instance of N vessels
+template <unsigned N>
+void bench_vessels_count(const BasicVesselsState<N> &volumes) {
+    BasicWaterPouringPuzzleSolver<N> solver{volumes};
+    const double time = seconds([&] { solver.solve_all(); });
+    fmt::print("{:>7} {:>28} {:>10} {:>12.1f}\n", N, BasicWaterPouringPuzzleSolver<N>::listed(volumes),
+               solver.discovered(), time / static_cast<double>(solver.discovered()) * 1e9);
+}
+
+/// Instances of 2 to 6 vessels, the vessel count is a template argument, the volumes are picked for a million or two
+/// states each, but two vessels never have many
+void bench_vessels() {
+    fmt::print("{:>7} {:>28} {:>10} {:>12}\n", "vessels", "volumes", "states", "ns/state");
+    bench_vessels_count(BasicVesselsState<2>{65519, 65521});
+    bench_vessels_count(BasicVesselsState<3>{300, 500, 801});
+    bench_vessels_count(BasicVesselsState<3>{1000, 1201, 1999});
+    bench_vessels_count(BasicVesselsState<4>{40, 51, 63, 77});
+    bench_vessels_count(BasicVesselsState<5>{13, 17, 19, 23, 29});
+    bench_vessels_count(BasicVesselsState<6>{7, 9, 11, 13, 16, 17});
+}
+
+template <typename Water, size_t N>
+void bench_width_of(const std::array<uint32_t, N> &numbers) {
+    using Solver = BasicWaterPouringPuzzleSolver<N, Water>;
+    typename Solver::State volumes;
+    std::transform(numbers.begin(), numbers.end(), volumes.begin(), [](uint32_t n) { return static_cast<Water>(n); });
+    Solver solver{volumes};
+    const double time = seconds([&] { solver.solve_all(); });
+    fmt::print("{:>6} {:>24} {:>10} {:>8} {:>8} {:>12.1f}\n", Solver::State::BITS, Solver::listed(volumes),
+               solver.discovered(), sizeof(typename Solver::State), sizeof(typename Solver::State::Packed),
+               time / static_cast<double>(solver.discovered()) * 1e9);
+}
+
+/// The same instances with the levels in 8, 16 and 32 bits, the narrower the smaller the history and the set keys
+void bench_widths() {
+    fmt::print("{:>6} {:>24} {:>10} {:>8} {:>8} {:>12}\n", "bits", "volumes", "states", "state B", "key B",
+               "ns/state");
+    const std::array<uint32_t, 3> three{100, 171, 222};
+    const std::array<uint32_t, 4> four{40, 51, 63, 77};
+    bench_width_of<uint8_t>(three);
+    bench_width_of<uint16_t>(three);
+    bench_width_of<uint32_t>(three);
+    bench_width_of<uint8_t>(four);
+    bench_width_of<uint16_t>(four);
+    bench_width_of<uint32_t>(four);
+    bench_width_of<uint32_t>(std::array<uint32_t, 2>{99991, 100003}); // Too big for 16 bits
+}
+
+/// The whole search of an instance with vessels of equal volume, only the canonical states are searched, and of the
+/// same one with a volume off by one, all of them
+template <unsigned N>
+void bench_symmetry_of(const BasicVesselsState<N> &volumes, unsigned vessel) {
+    BasicVesselsState<N> other = volumes;
+    ++other[vessel];
+    for (const BasicVesselsState<N> &instance : {volumes, other}) {
+        BasicWaterPouringPuzzleSolver<N> solver{instance};
+        const double time = seconds([&] { solver.solve_all(); });
+        fmt::print("{:>28} {:>10} {:>10.1f}\n", BasicWaterPouringPuzzleSolver<N>::listed(instance), solver.discovered(),
+                   time * 1e3);
+    }
+}
+
+void bench_symmetry() {
+    fmt::print("{:>28} {:>10} {:>10}\n", "volumes", "states", "ms");
+    bench_symmetry_of(VesselsState{1000, 1000, 1999}, 1);
+    bench_symmetry_of(BasicVesselsState<4>{51, 51, 77, 77}, 1);
+    bench_symmetry_of(BasicVesselsState<5>{19, 19, 19, 23, 23}, 1);
+}
+
+struct Benchmark {
+    const char *name;
+    void (*run)();
+};
+
+const std::array BENCHMARKS{
+    Benchmark{"next_states", bench_next_states},
+    Benchmark{"successors", bench_successors},
+    Benchmark{"solve", bench_solve},
+    Benchmark{"flat_set", bench_flat_set},
+    Benchmark{"hash", bench_hash},
+    Benchmark{"tracking", bench_tracking},
+    Benchmark{"queries", bench_queries},
+    Benchmark{"parallel", bench_parallel},
+    Benchmark{"oracle", bench_oracle},
+    Benchmark{"analytic", bench_analytic},
+    Benchmark{"bound", bench_bound},
+    Benchmark{"astar", bench_astar},
+    Benchmark{"bitmap", bench_bitmap},
+    Benchmark{"vessels", bench_vessels},
+    Benchmark{"widths", bench_widths},
+    Benchmark{"symmetry", bench_symmetry},
+};
+
+} // namespace
+
+int main(int argc, char *argv[]) {
+    const char *filter = argc > 1 ? argv[1] : "";
+    for (const Benchmark &benchmark : BENCHMARKS) {
+        if (strstr(benchmark.name, filter) != nullptr) {
+            fmt::print("== {}\n", benchmark.name);
+            benchmark.run();
+        }
+    }
+    return EXIT_SUCCESS;
+}
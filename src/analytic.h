@@ -0,0 +1,202 @@
+#pragma once
+
+#include <algorithm>
+#include <cassert>
+#include <cstdint>
+#include <limits>
+#include <type_traits>
+#include <vector>
+
+#include "utils.h"
+#include "vessels_state.h"
+
+/// Solutions without a search, by the classic two vessel pour and refill strategy: fill the source when it is empty,
+/// pour it into the sink and drain the sink when it is full, the other vessels are not used. The step count of a
+/// pairing has a closed form from the Bezout coefficients and the moves are generated in time linear in their count,
+/// no visited set. The shortest pairing is minimal for two vessels, with more it is proven only against a lower bound.
+class PourAndRefill {
+public:
+    constexpr inline static const uint64_t NONE = std::numeric_limits<uint64_t>::max();
+
+    struct Result {
+        int steps = -1;         // -1 if no pairing measures the target
+        bool minimal = false;   // Proven to be a shortest solution
+        unsigned source = 0;    // The vessel filled
+        unsigned sink = 0;      // The vessel drained, the same as source if it is just filled once
+    };
+
+    /// Step count of the strategy from the vessel of volume `source` to the one of volume `sink` until either holds
+    /// the target, NONE if it never does. Target 0 is not handled.
+    [[nodiscard]]
+    static constexpr uint64_t steps(uint64_t source, uint64_t sink, uint64_t target) noexcept {
+        if (source == 0 || sink == 0 || target > std::max(source, sink)) {
+            return NONE;
+        }
+        if (target == source) {
+            return 1; // The first fill
+        }
+        uint64_t best = NONE;
+        if (target == sink) {
+            best = 2 * ((sink + source - 1) / source); // Fill and pour until the sink is full the first time
+        }
+        const auto divisor = static_cast<uint64_t>(extended_gcd(int64_t(source), int64_t(sink)).gcd);
+        if (target % divisor != 0) {
+            return best;
+        }
+        // After x fills and y drains the vessels hold source * x - sink * y, the target shows up when that is
+        // target (the sink holds it, the source just got empty) or target + sink (the source holds it, the sink just
+        // got full). Either way source * x == target (mod sink), the smallest such x from the modular inverse.
+        const uint64_t period = sink / divisor;
+        const auto inverse = static_cast<uint64_t>(mod_inverse(int64_t(source / divisor), int64_t(period)));
+        uint64_t fills = (target / divisor) % period * inverse % period;
+        fills = fills == 0 ? period : fills;
+        if (target <= sink) { // Fills, pours emptying the source and drains, one each
+            uint64_t count = fills;
+            while (source * count < target) {
+                count += period;
+            }
+            best = std::min(best, 2 * (count + (source * count - target) / sink));
+        }
+        if (target < source) { // The last pour fills the sink, no drain and no pour emptying the source yet
+            uint64_t count = fills;
+            while (source * count < target + sink) {
+                count += period;
+            }
+            best = std::min(best, 2 * (count + (source * count - target) / sink) - 2);
+        }
+        return best;
+    }
+
+    /// Steps that are certainly needed: 1 unless it is 0, 2 unless it is a volume and 3 unless one pour from a full
+    /// vessel leaves it
+    template <typename State>
+    [[nodiscard]]
+    static constexpr int lower_bound(const State &volumes, typename State::Level target) noexcept {
+        if (target == 0) {
+            return 0;
+        }
+        if (volumes.contains(target)) {
+            return 1;
+        }
+        for (const uint64_t src : volumes) {
+            for (const uint64_t dst : volumes) {
+                if (dst != 0 && src == dst + target) {
+                    return 2;
+                }
+            }
+        }
+        return 3;
+    }
+
+    /// The best pairing of the vessels, minimal if there are just two vessels with volume or it reaches the lower bound
+    template <typename State>
+    [[nodiscard]]
+    static constexpr Result solve(const State &volumes, typename State::Level target) noexcept {
+        Result result{};
+        if (target == 0) {
+            result.steps = 0;
+            result.minimal = true;
+            return result;
+        }
+        const auto vessels = std::count_if(volumes.begin(), volumes.end(), [](auto volume) { return volume != 0; });
+        if (vessels < 2) {
+            return result; // The single vessel full is the full state, never entered
+        }
+        uint64_t best = NONE;
+        for (unsigned src = 0; src != State::VESSELS; ++src) {
+            for (unsigned dst = 0; dst != State::VESSELS; ++dst) {
+                const uint64_t count = src == dst ? (volumes[src] == target ? 1 : NONE)
+                                                  : steps(volumes[src], volumes[dst], target);
+                if (count < best) {
+                    best = count;
+                    result.source = src;
+                    result.sink = dst;
+                }
+            }
+        }
+        if (best == NONE || best > uint64_t(std::numeric_limits<int>::max())) {
+            return result;
+        }
+        result.steps = static_cast<int>(best);
+        result.minimal = vessels == 2 || result.steps == lower_bound(volumes, target);
+        return result;
+    }
+
+    /// The states of the strategy from the initial one to the first holding the target, `result` from solve()
+    template <typename State>
+    [[nodiscard]]
+    static std::vector<State> path(const State &volumes, typename State::Level target, const Result &result) {
+        assert(result.steps >= 0);
+        std::vector<State> states;
+        states.reserve(static_cast<size_t>(result.steps) + 1);
+        State state{};
+        states.push_back(state);
+        while (!state.contains(target)) {
+            if (state[result.sink] == volumes[result.sink] && result.sink != result.source) {
+                state[result.sink] = 0; // First, both full could be the full state
+            } else if (state[result.source] == 0) {
+                state[result.source] = volumes[result.source];
+            } else {
+                state = state.transfer(result.source, result.sink, volumes);
+            }
+            states.push_back(state);
+        }
+        assert(states.size() == static_cast<size_t>(result.steps) + 1);
+        return states;
+    }
+};
+
+static_assert(PourAndRefill::steps(3, 5, 4) == 8);  // 3 0, 0 3, 3 3, 1 5, 1 0, 0 1, 3 1, 0 4
+static_assert(PourAndRefill::steps(5, 3, 4) == 6);  // 5 0, 2 3, 2 0, 0 2, 5 2, 4 3
+static_assert(PourAndRefill::steps(2, 3, 1) == 4);  // 2 0, 0 2, 2 2, 1 3
+static_assert(PourAndRefill::steps(2, 3, 3) == 4);  // 2 0, 0 2, 2 2, 1 3
+static_assert(PourAndRefill::steps(4, 6, 3) == PourAndRefill::NONE);
+static_assert(PourAndRefill::lower_bound(VesselsState{3, 5, 8}, 2) == 2);
+static_assert(PourAndRefill::lower_bound(VesselsState{3, 5, 8}, 4) == 3);
+static_assert(PourAndRefill::solve(VesselsState{0, 3, 5}, 4).steps == 6);
+static_assert(PourAndRefill::solve(VesselsState{0, 3, 5}, 4).minimal);
+static_assert(!PourAndRefill::solve(VesselsState{3, 5, 8}, 4).minimal);
+static_assert(PourAndRefill::solve(BasicVesselsState<4>{3, 5, 0, 8}, 3).minimal);
+static_assert(PourAndRefill::lower_bound(BasicVesselsState<3, uint32_t>{4294967295, 4294967294, 1}, 4294967294) == 1);
+static_assert(PourAndRefill::steps(4294967295, 4294967294, 1) == 2);
+static_assert(PourAndRefill::steps(4294967294, 4294967295, 1) == 4 * uint64_t(4294967295) - 8); // No 64 bit overflow
+static_assert([] { // The best pairing of two vessels is the shortest solution, with more vessels it is a solution
+    for (const BasicVesselsState<2> volumes : {BasicVesselsState<2>{3, 5}, BasicVesselsState<2>{2, 9},
+                                               BasicVesselsState<2>{4, 6}, BasicVesselsState<2>{7, 11},
+                                               BasicVesselsState<2>{1, 13}, BasicVesselsState<2>{0, 6}}) {
+        const auto steps = reference_steps(volumes);
+        for (water target = 0; target != steps.size(); ++target) {
+            if (PourAndRefill::solve(volumes, target).steps != steps[target]) {
+                return false;
+            }
+        }
+    }
+    for (const VesselsState volumes : {VesselsState{3, 5, 8}, VesselsState{2, 6, 9}, VesselsState{4, 4, 9},
+                                       VesselsState{5, 7, 9}, VesselsState{1, 2, 12}}) {
+        const auto steps = reference_steps(volumes);
+        for (water target = 0; target != steps.size(); ++target) {
+            const int analytic = PourAndRefill::solve(volumes, target).steps;
+            if (analytic >= 0 && (steps[target] < 0 || analytic < steps[target])) {
+                return false;
+            }
+        }
+    }
+    return true;
+}());
+static_assert([] { // The lower bound holds and a pairing proven minimal is the shortest solution
+    constexpr auto bounded = [](const auto &volumes) {
+        const auto steps = reference_steps(volumes);
+        for (water target = 0; target != steps.size(); ++target) {
+            const auto amount = static_cast<typename std::remove_cvref_t<decltype(volumes)>::Level>(target);
+            const PourAndRefill::Result analytic = PourAndRefill::solve(volumes, amount);
+            if ((steps[target] >= 0 && PourAndRefill::lower_bound(volumes, amount) > steps[target]) ||
+                (analytic.minimal && analytic.steps != steps[target])) {
+                return false;
+            }
+        }
+        return true;
+    };
+    return bounded(VesselsState{3, 5, 8}) && bounded(VesselsState{2, 6, 9}) && bounded(VesselsState{4, 4, 9}) &&
+           bounded(VesselsState{0, 3, 5}) && bounded(VesselsState{1, 2, 12}) &&
+           bounded(BasicVesselsState<4>{2, 3, 4, 6}) && bounded(BasicVesselsState<4>{3, 5, 0, 8});
+}());
@@ -0,0 +1,185 @@
+#pragma once
+
+#include <cassert>
+#include <cstdint>
+#include <limits>
+#include <unordered_map>
+#include <vector>
+
+#include "packed_state.h"
+#include "solver.h"
+#include "vessels_state.h"
+
+/// A* search for the shortest solution, an alternative to the BFS of WaterPouringPuzzleSolver with the same step
+/// counts. The heuristic is the exact distance to the target up to 2: 0 if a vessel holds it, 1 if a single move gets
+/// it, 2 otherwise, so it is admissible and consistent and no state is expanded twice. The costs are small integers,
+/// the open list is a bucket queue by f = g + h. No parents are kept, the path is rebuilt from the depths.
+/// The State the search works on is VesselsState or the PackedState of the same levels, the volumes and the path are
+/// VesselsState either way.
+template <typename State = PackedState>
+class BasicAStarSolver {
+    constexpr inline static const uint32_t UNSEEN = std::numeric_limits<uint32_t>::max();
+    constexpr inline static const uint64_t DENSE_LIMIT = uint64_t(1) << 28; // 1 GiB of depths
+
+    struct Entry {
+        State state;
+        uint32_t depth; // g when pushed, stale if a shorter way was found since
+    };
+
+    water m_scale;                                       // The common divisor of the volumes
+    State m_volumes;                                     // Divided by m_scale
+    std::vector<uint32_t> m_depths{};                    // g per surface rank if it fits
+    std::unordered_map<State, uint32_t, State> m_sparse{}; // g per state otherwise
+    std::vector<std::vector<Entry>> m_buckets{};         // Open states by f
+    uint64_t m_expanded = 0;
+    uint64_t m_discovered = 0;
+    std::vector<State> m_path{};
+
+public:
+    explicit BasicAStarSolver(const VesselsState &volumes)
+        : m_scale(WaterPouringPuzzleSolver::common_divisor(volumes)), m_volumes(volumes.divided(m_scale)) {}
+
+    /// Returns in how many steps it can be solved, -1 is no solution, see path() for the solution
+    int solve(const water target) {
+        m_path.clear();
+        m_expanded = 0;
+        m_discovered = 0;
+        if (!WaterPouringPuzzleSolver::measurable(static_cast<VesselsState>(m_volumes.scaled(m_scale)), target)) {
+            return -1;
+        }
+        const auto reduced = static_cast<water>(target / m_scale);
+        init();
+
+        const State initial{0, 0, 0};
+        set_depth(initial, 0);
+        push(initial, 0, reduced);
+        for (size_t cost = 0; cost < m_buckets.size(); ++cost) {
+            while (!m_buckets[cost].empty()) {
+                const Entry entry = m_buckets[cost].back(); // The deepest first among the equal costs
+                m_buckets[cost].pop_back();
+                if (entry.depth != depth(entry.state)) {
+                    continue; // Stale
+                }
+                if (entry.state.contains(reduced)) {
+                    rebuild(entry.state);
+                    return static_cast<int>(entry.depth);
+                }
+                ++m_expanded;
+                for (const State next : entry.state.next_states(m_volumes)) {
+                    if (next != m_volumes && entry.depth + 1 < depth(next)) { // The full state is never entered
+                        set_depth(next, entry.depth + 1);
+                        push(next, entry.depth + 1, reduced);
+                    }
+                }
+            }
+        }
+        return -1;
+    }
+
+    /// The states of the last solution, from the initial one to the goal
+    [[nodiscard]]
+    std::vector<VesselsState> path() const {
+        std::vector<VesselsState> states;
+        states.reserve(m_path.size());
+        for (const State &state : m_path) {
+            states.push_back(static_cast<VesselsState>(state.scaled(m_scale)));
+        }
+        return states;
+    }
+
+    /// States expanded by the last solve
+    [[nodiscard]]
+    uint64_t expanded() const noexcept {
+        return m_expanded;
+    }
+
+    /// States given a depth by the last solve
+    [[nodiscard]]
+    uint64_t discovered() const noexcept {
+        return m_discovered;
+    }
+
+    /// Lower bound of the moves from the state to one holding the target, exact up to 2
+    [[nodiscard]]
+    static constexpr unsigned heuristic(const State &state, const State &volumes, water target) noexcept {
+        if (state.contains(target)) {
+            return 0;
+        }
+        for (const State next : state.next_states(volumes)) {
+            if (next != volumes && next.contains(target)) {
+                return 1;
+            }
+        }
+        return 2;
+    }
+
+protected:
+    /// Size the depths, per surface rank if they fit and a map otherwise, the full state is skipped by the callers
+    void init() {
+        m_buckets.clear();
+        if (m_volumes.surface_size() <= DENSE_LIMIT) {
+            m_sparse = {};
+            m_depths.assign(m_volumes.surface_size(), UNSEEN);
+        } else {
+            m_depths = {};
+            m_sparse.clear();
+        }
+    }
+
+    [[nodiscard]]
+    uint32_t depth(const State &state) const {
+        if (!m_depths.empty()) {
+            return m_depths[state.surface_rank(m_volumes)];
+        }
+        const auto found = m_sparse.find(state);
+        return found == m_sparse.end() ? UNSEEN : found->second;
+    }
+
+    void set_depth(const State &state, uint32_t depth) {
+        m_discovered += this->depth(state) == UNSEEN ? 1 : 0;
+        if (!m_depths.empty()) {
+            m_depths[state.surface_rank(m_volumes)] = depth;
+        } else {
+            m_sparse[state] = depth;
+        }
+    }
+
+    void push(const State &state, uint32_t depth, water target) {
+        const size_t cost = depth + heuristic(state, m_volumes, target);
+        if (cost >= m_buckets.size()) {
+            m_buckets.resize(cost + 1);
+        }
+        m_buckets[cost].push_back({state, depth});
+    }
+
+    /// Walk back from the goal, a predecessor one shallower always exists: a state got its depth from a parent one
+    /// shallower, a state on a shortest path can only have its shortest depth.
+    void rebuild(const State &goal) {
+        auto level = depth(goal);
+        m_path.assign(level + 1, goal);
+        State state = goal;
+        while (level != 0) {
+            bool found = false;
+            for (unsigned code = 0; code != MOVES_COUNT && !found; ++code) {
+                state.for_each_prev(static_cast<Move>(code), m_volumes, [&](const State &prev) {
+                    if (!found && prev.on_surface(m_volumes) && prev != m_volumes && depth(prev) == level - 1) {
+                        state = prev;
+                        found = true;
+                    }
+                });
+            }
+            assert(found);
+            m_path[--level] = state;
+        }
+    }
+};
+
+/// A* on the levels packed in a word
+using AStarSolver = BasicAStarSolver<>;
+
+static_assert(BasicAStarSolver<VesselsState>::heuristic(VesselsState{3, 0, 0}, VesselsState{3, 5, 8}, 4) == 2);
+static_assert(AStarSolver::heuristic(PackedState{3, 0, 0}, PackedState{3, 5, 8}, 3) == 0);
+static_assert(AStarSolver::heuristic(PackedState{3, 0, 0}, PackedState{3, 5, 8}, 5) == 1); // Fill
+static_assert(AStarSolver::heuristic(PackedState{0, 5, 0}, PackedState{3, 5, 8}, 2) == 1); // Pour
+static_assert(AStarSolver::heuristic(PackedState{3, 5, 0}, PackedState{3, 5, 8}, 8) == 2); // Only the full state
+static_assert(AStarSolver::heuristic(PackedState{0, 0, 0}, PackedState{3, 5, 8}, 4) == 2);
@@ -0,0 +1,131 @@
+#pragma once
+
+#include <algorithm>
+#include <bit>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "hash.h"
+#include "vessels_state.h"
+
+/// Open addressing hash set of packed states, linear probing in one flat array of State::Packed slots from the slot the
+/// low bits of the Hash policy pick. No node per element like std::unordered_set, a lookup touches one or two cache
+/// lines. Kept at most half full, it doubles when it gets there. There is no erase, the search never forgets a state.
+/// Plain linear probing and no Robin Hood or Swiss table control bytes: half full with a mixing hash a lookup reads
+/// 1.1 to 1.3 slots on average (bench hash), there is nothing left for either to shorten, and both cost extra work on
+/// every insert or an extra metadata array.
+template <typename State = VesselsState, typename Hash = MixHash>
+class FlatStateSet {
+    using Key = typename State::Packed;
+
+    constexpr inline static const Key EMPTY = State::NOT_PACKED;
+    constexpr inline static const size_t MIN_SLOTS = 16;
+
+    std::vector<Key> m_slots = std::vector<Key>(MIN_SLOTS, EMPTY); // Power of 2 size
+    size_t m_size = 0;
+
+public:
+    /// Remove all the states, keep the memory
+    void clear() noexcept {
+        std::fill(m_slots.begin(), m_slots.end(), EMPTY);
+        m_size = 0;
+    }
+
+    /// Make room for `count` states without growing
+    void reserve(size_t count) {
+        const size_t slots = std::bit_ceil(std::max(count * 2, MIN_SLOTS));
+        if (slots > m_slots.size()) {
+            rehash(slots);
+        }
+    }
+
+    [[nodiscard]]
+    size_t size() const noexcept {
+        return m_size;
+    }
+
+    /// Add the state, returns false if it was already there
+    bool insert(const State &state) {
+        if ((m_size + 1) * 2 > m_slots.size()) {
+            rehash(m_slots.size() * 2);
+        }
+        const Key key = state.packed();
+        for (size_t slot = home(state);; slot = (slot + 1) & (m_slots.size() - 1)) {
+            if (m_slots[slot] == key) {
+                return false;
+            }
+            if (m_slots[slot] == EMPTY) {
+                m_slots[slot] = key;
+                ++m_size;
+                return true;
+            }
+        }
+    }
+
+    [[nodiscard]]
+    bool contains(const State &state) const noexcept {
+        const Key key = state.packed();
+        for (size_t slot = home(state);; slot = (slot + 1) & (m_slots.size() - 1)) {
+            if (m_slots[slot] == key) {
+                return true;
+            }
+            if (m_slots[slot] == EMPTY) {
+                return false;
+            }
+        }
+    }
+
+    /// Start loading the cache line the state's probe starts at, for a batch of lookups soon after
+    void prefetch(const State &state) const noexcept {
+        __builtin_prefetch(&m_slots[home(state)]);
+    }
+
+    /// Share of the states not in their home slot
+    [[nodiscard]]
+    double collision_rate() const noexcept {
+        size_t moved = 0;
+        for_each_distance([&moved](size_t distance) { moved += distance != 0 ? 1 : 0; });
+        return m_size == 0 ? 0.0 : static_cast<double>(moved) / static_cast<double>(m_size);
+    }
+
+    /// Mean count of slots a lookup of a present state reads
+    [[nodiscard]]
+    double mean_probe() const noexcept {
+        size_t probes = 0;
+        for_each_distance([&probes](size_t distance) { probes += distance + 1; });
+        return m_size == 0 ? 0.0 : static_cast<double>(probes) / static_cast<double>(m_size);
+    }
+
+protected:
+    [[nodiscard]]
+    size_t home(const State &state) const noexcept {
+        return Hash{}(state) & (m_slots.size() - 1);
+    }
+
+    /// Call `visit(distance)` with the distance of every state from its home slot
+    template <typename Visit>
+    void for_each_distance(Visit &&visit) const {
+        for (size_t slot = 0; slot != m_slots.size(); ++slot) {
+            if (m_slots[slot] != EMPTY) {
+                visit((slot - home(State::unpacked(m_slots[slot]))) & (m_slots.size() - 1));
+            }
+        }
+    }
+
+    void rehash(size_t slots) {
+        assert(std::has_single_bit(slots));
+        std::vector<Key> old(slots, EMPTY);
+        old.swap(m_slots);
+        for (const Key &key : old) {
+            if (key != EMPTY) {
+                size_t slot = home(State::unpacked(key));
+                while (m_slots[slot] != EMPTY) {
+                    slot = (slot + 1) & (m_slots.size() - 1);
+                }
+                m_slots[slot] = key;
+            }
+        }
+    }
+};
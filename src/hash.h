@@ -0,0 +1,81 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <type_traits>
+
+#include "vessels_state.h"
+
+// Hash policies for the sets of states, called like std::hash. FlatStateSet takes the low bits of the hash as the home
+// slot, std::unordered_set the remainder by a prime bucket count.
+
+/// The exact packed state if it fits in 64 bits, no collisions in a big enough table, but the low bits are the first
+/// vessel only
+struct PackHash {
+    template <typename State>
+    constexpr size_t operator()(const State &state) const noexcept {
+        return fold(state.packed());
+    }
+};
+
+/// Multiply by 2^64 / golden ratio and fold the top half down, every bit of the state reaches the low bits
+struct MixHash {
+    template <typename State>
+    constexpr size_t operator()(const State &state) const noexcept {
+        const uint64_t product = fold(state.packed()) * 0x9E3779B97F4A7C15ULL;
+        return product ^ (product >> 32);
+    }
+};
+
+/// CRC-32C of the packed state 8 bytes at a time, the SSE 4.2 crc32 instruction if the build targets it, a table lookup
+/// per byte otherwise
+struct CrcHash {
+    template <typename State>
+    constexpr size_t operator()(const State &state) const noexcept {
+        return ~update(~uint32_t(0), state.packed());
+    }
+
+private:
+    static constexpr uint32_t update(uint32_t crc, uint128 packed) noexcept {
+        return update(update(crc, static_cast<uint64_t>(packed)), static_cast<uint64_t>(packed >> 64));
+    }
+
+    template <size_t WORDS>
+    static constexpr uint32_t update(uint32_t crc, const std::array<uint64_t, WORDS> &packed) noexcept {
+        for (const uint64_t word : packed) {
+            crc = update(crc, word);
+        }
+        return crc;
+    }
+
+    static constexpr uint32_t update(uint32_t crc, uint64_t word) noexcept {
+#if defined(__SSE4_2__)
+        if (!std::is_constant_evaluated()) {
+            return static_cast<uint32_t>(__builtin_ia32_crc32di(crc, word));
+        }
+#endif
+        for (unsigned byte = 0; byte != 8; ++byte, word >>= 8) {
+            crc = TABLE[(crc ^ word) & 0xFF] ^ (crc >> 8);
+        }
+        return crc;
+    }
+
+    constexpr inline static const std::array<uint32_t, 256> TABLE = [] {
+        std::array<uint32_t, 256> table{};
+        for (uint32_t byte = 0; byte != 256; ++byte) {
+            uint32_t crc = byte;
+            for (unsigned bit = 0; bit != 8; ++bit) {
+                crc = (crc >> 1) ^ ((crc & 1) != 0 ? 0x82F63B78U : 0); // Castagnoli, reflected
+            }
+            table[byte] = crc;
+        }
+        return table;
+    }();
+};
+
+static_assert(PackHash{}(VesselsState{1, 2, 3}) == 0x0003'0002'0001);
+static_assert(MixHash{}(VesselsState{1, 0, 0}) != MixHash{}(VesselsState{0, 1, 0}));
+static_assert(CrcHash{}(VesselsState{1, 2, 3}) == 0x7CBAE657); // CRC-32C of the 8 packed bytes
+static_assert(MixHash{}(BasicVesselsState<5>{0, 0, 0, 0, 1}) != MixHash{}(BasicVesselsState<5>{0, 0, 0, 0, 2}));
+static_assert(PackHash{}(BasicVesselsState<3, uint8_t>{1, 2, 3}) == 0x03'02'01);
@@ -0,0 +1,233 @@
+#pragma once
+
+#include <atomic>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <stdexcept>
+#include <vector>
+
+#include "vessels_state.h"
+
+/// States in discovery order and the index of the state each one was discovered from.
+/// Kept as two separate arrays, sizeof(State) per state (the width of its Level per vessel) plus 4 bytes per parent
+/// index, the parents are 8 bytes only if the instance can have more than 2^32 states. Without parents it is just the
+/// BFS queue, the states already expanded can be dropped from the front, the indices of the rest do not change.
+template <typename State>
+class BasicHistory {
+public:
+    using Index = uint64_t;
+    constexpr inline static const Index NO_PARENT = std::numeric_limits<Index>::max();
+
+protected:
+    constexpr inline static const uint32_t NO_PARENT32 = std::numeric_limits<uint32_t>::max();
+
+    std::vector<State> m_states{};
+    std::vector<uint32_t> m_parents32{}; // Used if !m_wide
+    std::vector<uint64_t> m_parents64{}; // Used if m_wide
+    Index m_first = 0;                   // Index of m_states.front(), the count of dropped states
+    bool m_parents = true;
+    bool m_wide = false;
+
+public:
+    /// Forget everything, pick the parent index width for up to `max_states` states and reserve room for `reserve`
+    void reset(uint64_t max_states, size_t reserve, bool parents = true) {
+        m_parents = parents;
+        m_wide = max_states >= NO_PARENT32;
+        m_first = 0;
+        m_states.clear();
+        m_parents32 = std::vector<uint32_t>{};
+        m_parents64 = std::vector<uint64_t>{};
+        m_states.reserve(reserve);
+        if (!m_parents) {
+            return;
+        }
+        if (m_wide) {
+            m_parents64.reserve(reserve);
+        } else {
+            m_parents32.reserve(reserve);
+        }
+    }
+
+    /// Are the parent indices kept?
+    [[nodiscard]]
+    bool parents() const noexcept {
+        return m_parents;
+    }
+
+    void push_back(const State &state, Index parent) {
+        m_states.push_back(state);
+        if (!m_parents) {
+            return;
+        }
+        if (m_wide) {
+            m_parents64.push_back(parent);
+        } else {
+            assert(parent == NO_PARENT || parent < NO_PARENT32);
+            m_parents32.push_back(parent == NO_PARENT ? NO_PARENT32 : static_cast<uint32_t>(parent));
+        }
+    }
+
+    /// Append `count` states to be filled in by set(), possibly from several threads at once
+    void grow(size_t count) {
+        m_states.resize(m_states.size() + count);
+        if (!m_parents) {
+            return;
+        }
+        if (m_wide) {
+            m_parents64.resize(m_states.size());
+        } else {
+            m_parents32.resize(m_states.size());
+        }
+    }
+
+    /// Fill in a state added by grow()
+    void set(Index idx, const State &state, Index parent) noexcept {
+        assert(idx >= m_first && idx < size());
+        m_states[idx - m_first] = state;
+        if (!m_parents) {
+            return;
+        }
+        if (m_wide) {
+            m_parents64[idx] = parent;
+        } else {
+            assert(parent == NO_PARENT || parent < NO_PARENT32);
+            m_parents32[idx] = parent == NO_PARENT ? NO_PARENT32 : static_cast<uint32_t>(parent);
+        }
+    }
+
+    /// Count of states ever pushed, the index of the next one
+    [[nodiscard]]
+    Index size() const noexcept {
+        return m_first + m_states.size();
+    }
+
+    [[nodiscard]]
+    bool empty() const noexcept {
+        return size() == 0;
+    }
+
+    [[nodiscard]]
+    const State &state(Index idx) const noexcept {
+        assert(idx >= m_first && idx < size());
+        return m_states[idx - m_first];
+    }
+
+    /// Forget the states before index `first`. Only without parents.
+    void drop_front(Index first) {
+        assert(!m_parents && first >= m_first && first <= size());
+        m_states.erase(m_states.begin(), m_states.begin() + static_cast<std::ptrdiff_t>(first - m_first));
+        m_first = first;
+    }
+
+    /// Index of the state `idx` was discovered from, NO_PARENT for the initial state
+    [[nodiscard]]
+    Index parent(Index idx) const noexcept {
+        assert(m_parents && idx < m_states.size());
+        if (m_wide) {
+            return m_parents64[idx];
+        }
+        const uint32_t parent = m_parents32[idx];
+        return parent == NO_PARENT32 ? NO_PARENT : parent;
+    }
+};
+
+using History = BasicHistory<VesselsState>;
+
+/// Dense table keyed by the state id, the 4-bit code of the move each discovered state was first reached by and the BFS
+/// depth modulo DEPTHS in the remaining 12 bits, the move codes of up to 3 vessels fit. A drain or a transfer can be
+/// undone in many ways and some of those predecessors may be deeper than the state itself; the depth residue tells the
+/// right ones apart. Two bytes per state of the id space instead of a 10 bytes history entry per discovered state.
+class MoveTable {
+public:
+    constexpr inline static const uint8_t NONE = 0xF;  // Not discovered
+    constexpr inline static const uint8_t START = 0xC; // Discovered without a move, the initial state
+    constexpr inline static const unsigned DEPTHS = 1U << 12;
+
+protected:
+    std::vector<uint16_t> m_entries{};
+
+public:
+    /// Forget everything and size for ids in [0, size), a saturated size is rejected
+    void reset(uint64_t size) {
+        if (size == SATURATED) {
+            throw std::length_error("MoveTable: the id space does not fit");
+        }
+        m_entries.assign(size, 0xFFFF);
+    }
+
+    /// The move code, NONE if not discovered
+    [[nodiscard]]
+    uint8_t move(uint64_t id) const noexcept {
+        assert(id < m_entries.size());
+        return static_cast<uint8_t>(m_entries[id] & 0xF);
+    }
+
+    /// The depth modulo DEPTHS, valid if discovered
+    [[nodiscard]]
+    unsigned depth(uint64_t id) const noexcept {
+        assert(id < m_entries.size());
+        return m_entries[id] >> 4U;
+    }
+
+    void set(uint64_t id, uint8_t move, unsigned depth) noexcept {
+        assert(id < m_entries.size() && move <= 0xF);
+        m_entries[id] = static_cast<uint16_t>((depth % DEPTHS) << 4U | move);
+    }
+};
+
+/// Dense table keyed by the state id, the BFS depth modulo 3 of each discovered state in 2 bits, 0 if not discovered.
+/// The residue tells a state a level deeper from one a level shallower, but not from one 3 levels deeper. 2 bits per
+/// state of the id space instead of the 2 bytes of MoveTable and there is no limit on the move count.
+class DepthTable {
+public:
+    constexpr inline static const unsigned DEPTHS = 3;
+
+protected:
+    std::vector<uint64_t> m_words{}; // 32 entries each
+
+public:
+    /// Forget everything and size for ids in [0, size), a saturated size is rejected
+    void reset(uint64_t size) {
+        if (size == SATURATED) {
+            throw std::length_error("DepthTable: the id space does not fit");
+        }
+        m_words.assign(div_ceil(size, 32), 0);
+    }
+
+    [[nodiscard]]
+    bool discovered(uint64_t id) const noexcept {
+        return entry(id) != 0;
+    }
+
+    /// The depth modulo DEPTHS, valid if discovered
+    [[nodiscard]]
+    unsigned depth(uint64_t id) const noexcept {
+        assert(discovered(id));
+        return entry(id) - 1;
+    }
+
+    /// Record the depth of a state discovered just now
+    void set(uint64_t id, unsigned depth) noexcept {
+        assert(!discovered(id));
+        m_words[id / 32] |= bits(id, depth);
+    }
+
+    /// set() that can be called from several threads at once, the neighbours share the word
+    void set_atomic(uint64_t id, unsigned depth) noexcept {
+        assert(!discovered(id));
+        std::atomic_ref<uint64_t>(m_words[id / 32]).fetch_or(bits(id, depth), std::memory_order_relaxed);
+    }
+
+private:
+    [[nodiscard]]
+    unsigned entry(uint64_t id) const noexcept {
+        assert(id / 32 < m_words.size());
+        return static_cast<unsigned>(m_words[id / 32] >> (id % 32 * 2) & 3);
+    }
+
+    static uint64_t bits(uint64_t id, unsigned depth) noexcept {
+        return uint64_t(depth % DEPTHS + 1) << (id % 32 * 2);
+    }
+};
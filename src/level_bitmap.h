@@ -0,0 +1,328 @@
+#pragma once
+
+#include <algorithm>
+#include <bit>
+#include <cassert>
+#include <cstdint>
+#include <vector>
+
+#include "solver.h"
+#include "vessels_state.h"
+
+/// Breadth first search of all the amounts a whole level at a time, on bitmaps of the box for moderate volumes.
+/// A row holds the states of one (V0, V1) pair with the V2 levels as bits, padded to whole words. Fills, drains and
+/// the V0, V1 transfers move whole rows, a transfer with V2 shifts the bits of a row where it is not clipped by the
+/// volumes and moves single bits where it is. A level is expand(frontier) & ~visited, only the rows with a frontier
+/// bit are expanded. The ids of each level are kept in ascending order, the path walks back by binary searching them.
+class LevelBitmapSolver {
+public:
+    using Solution = WaterPouringPuzzleSolver::Solution;
+
+    constexpr inline static const uint64_t BITS_LIMIT = uint64_t(1) << 26; // 8 MiB per bitmap, there are 3
+
+protected:
+    water m_scale;                   // The common divisor of the volumes
+    VesselsState m_volumes;          // Divided by m_scale
+    size_t m_words;                  // Per row
+    size_t m_rows;                   // (V0 + 1) * (V1 + 1)
+    std::vector<uint64_t> m_visited; // The bitmaps, m_rows * m_words each
+    std::vector<uint64_t> m_frontier;
+    std::vector<uint64_t> m_next;
+    std::vector<uint32_t> m_active{};    // Rows with a frontier bit
+    std::vector<uint32_t> m_touched{};   // Rows with a next bit
+    std::vector<uint8_t> m_is_touched{}; // By row
+    std::vector<uint32_t> m_ids{};       // Bit index of the discovered states by level, ascending within a level
+    std::vector<size_t> m_levels{};      // Start of each level in m_ids
+    std::vector<Solution> m_table{};     // The first state holding each amount
+
+public:
+    explicit LevelBitmapSolver(const VesselsState &volumes)
+        : m_scale(WaterPouringPuzzleSolver::common_divisor(volumes)), m_volumes(volumes.divided(m_scale)),
+          m_words((size_t(m_volumes[2]) + 64) / 64), m_rows((size_t(m_volumes[0]) + 1) * (size_t(m_volumes[1]) + 1)),
+          m_visited(m_rows * m_words), m_frontier(m_rows * m_words), m_next(m_rows * m_words) {
+        assert(fits(volumes));
+    }
+
+    /// Are the bitmaps for the volumes small enough?
+    [[nodiscard]]
+    static constexpr bool fits(const VesselsState &volumes) noexcept {
+        const VesselsState reduced = volumes.divided(WaterPouringPuzzleSolver::common_divisor(volumes));
+        return (uint64_t(reduced[0]) + 1) * (uint64_t(reduced[1]) + 1) * ((uint64_t(reduced[2]) + 64) / 64 * 64) <=
+               BITS_LIMIT;
+    }
+
+    /// Returns in how many steps it can be solved, -1 is no solution. The levels are expanded until the target is seen.
+    int solve(const water target) {
+        if (!WaterPouringPuzzleSolver::measurable(volumes(), target)) {
+            return -1;
+        }
+        start();
+        const auto reduced = static_cast<water>(target / m_scale);
+        while (m_table[reduced].steps < 0 && expand_level()) {
+        }
+        return m_table[reduced].steps;
+    }
+
+    /// Expand all the levels, then solution() has the shortest solution of every amount
+    void solve_all() {
+        start();
+        while (expand_level()) {
+        }
+    }
+
+    [[nodiscard]]
+    VesselsState volumes() const noexcept {
+        return m_volumes.scaled(m_scale);
+    }
+
+    /// The shortest solution found for the target so far
+    [[nodiscard]]
+    Solution solution(water target) const {
+        const water reduced = target / m_scale;
+        if (!WaterPouringPuzzleSolver::measurable(volumes(), target) || size_t(reduced) >= m_table.size()) {
+            return {};
+        }
+        Solution solution = m_table[reduced];
+        solution.state = solution.state.scaled(m_scale);
+        return solution;
+    }
+
+    /// Number of states discovered so far
+    [[nodiscard]]
+    size_t discovered() const noexcept {
+        return m_ids.size();
+    }
+
+    /// The states of a solution, from the initial one to the goal
+    [[nodiscard]]
+    std::vector<VesselsState> path(const Solution &solution) const {
+        if (solution.steps < 0) {
+            return {};
+        }
+        auto level = static_cast<size_t>(solution.steps);
+        std::vector<VesselsState> states(level + 1, solution.state.divided(m_scale));
+        while (level != 0) {
+            --level;
+            bool found = false;
+            for (unsigned code = 0; code != MOVES_COUNT && !found; ++code) {
+                states[level + 1].for_each_prev(static_cast<Move>(code), m_volumes, [&](const VesselsState &prev) {
+                    if (!found && in_level(level, prev)) {
+                        states[level] = prev;
+                        found = true;
+                    }
+                });
+            }
+            assert(found);
+        }
+        for (VesselsState &state : states) {
+            state = state.scaled(m_scale);
+        }
+        return states;
+    }
+
+protected:
+    [[nodiscard]]
+    size_t row(unsigned v0, unsigned v1) const noexcept {
+        return size_t(v0) * (size_t(m_volumes[1]) + 1) + v1;
+    }
+
+    [[nodiscard]]
+    uint32_t id(const VesselsState &state) const noexcept {
+        return static_cast<uint32_t>(row(state[0], state[1]) * m_words * 64 + state[2]);
+    }
+
+    [[nodiscard]]
+    bool in_level(size_t level, const VesselsState &state) const {
+        const auto first = m_ids.begin() + static_cast<ptrdiff_t>(m_levels[level]);
+        const auto last =
+            level + 1 == m_levels.size() ? m_ids.end() : m_ids.begin() + static_cast<ptrdiff_t>(m_levels[level + 1]);
+        return std::binary_search(first, last, id(state));
+    }
+
+    void start() {
+        if (!m_levels.empty()) {
+            return; // Resumed
+        }
+        m_is_touched.assign(m_rows, 0);
+        m_table.assign(size_t(*std::max_element(m_volumes.begin(), m_volumes.end())) + 1, Solution{});
+        const VesselsState initial{0, 0, 0};
+        for (const VesselsState &state : {initial, m_volumes}) { // The full state is never entered
+            m_visited[id(state) / 64] |= uint64_t(1) << (id(state) % 64);
+        }
+        m_frontier[0] = 1;
+        m_active.push_back(0);
+        m_levels.push_back(0);
+        m_ids.push_back(0);
+        record(initial, 0);
+    }
+
+    void record(const VesselsState &state, size_t level) {
+        for (const water amount : state) {
+            if (m_table[amount].steps < 0) {
+                m_table[amount] = {static_cast<int>(level), state, static_cast<History::Index>(m_ids.size() - 1)};
+            }
+        }
+    }
+
+    /// Expand the frontier into the next level, false if it is empty
+    bool expand_level() {
+        const unsigned full0 = m_volumes[0];
+        const unsigned full1 = m_volumes[1];
+        const unsigned full2 = m_volumes[2];
+        for (const uint32_t index : m_active) {
+            const auto v0 = static_cast<unsigned>(index / (full1 + 1));
+            const auto v1 = static_cast<unsigned>(index % (full1 + 1));
+            const uint64_t *bits = &m_frontier[index * m_words];
+            or_row(v0 == 0 ? row(full0, v1) : row(0, v1), bits); // Fill or drain V0
+            or_row(v1 == 0 ? row(v0, full1) : row(v0, 0), bits); // Fill or drain V1
+            if ((bits[0] & 1) != 0) {
+                set_bit(index, full2); // Fill V2
+            }
+            if (any_bit(bits, 1, full2)) {
+                set_bit(index, 0); // Drain V2
+            }
+            if (v0 > 0 && v1 < full1) {
+                const unsigned poured = std::min(v0, full1 - v1);
+                or_row(row(v0 - poured, v1 + poured), bits);
+            }
+            if (v1 > 0 && v0 < full0) {
+                const unsigned poured = std::min(v1, full0 - v0);
+                or_row(row(v0 + poured, v1 - poured), bits);
+            }
+            transfer_v2(bits, v0, full0, [&](unsigned amount) { return row(amount, v1); });
+            transfer_v2(bits, v1, full1, [&](unsigned amount) { return row(v0, amount); });
+        }
+        for (const uint32_t index : m_active) {
+            std::fill_n(&m_frontier[index * m_words], m_words, 0);
+        }
+        m_active.clear();
+
+        std::sort(m_touched.begin(), m_touched.end());
+        const size_t level = m_levels.size();
+        m_levels.push_back(m_ids.size());
+        for (const uint32_t index : m_touched) {
+            m_is_touched[index] = 0;
+            const VesselsState base{static_cast<water>(index / (full1 + 1)), static_cast<water>(index % (full1 + 1)),
+                                    0};
+            bool found = false;
+            for (size_t word = index * m_words; word != (index + 1) * m_words; ++word) {
+                const uint64_t found_bits = m_next[word] & ~m_visited[word];
+                m_next[word] = 0;
+                m_visited[word] |= found_bits;
+                m_frontier[word] = found_bits;
+                found = found || found_bits != 0;
+                for (uint64_t rest = found_bits; rest != 0; rest &= rest - 1) {
+                    VesselsState state = base;
+                    state[2] = static_cast<water>((word - index * m_words) * 64 + unsigned(std::countr_zero(rest)));
+                    m_ids.push_back(id(state));
+                    record(state, level);
+                }
+            }
+            if (found) {
+                m_active.push_back(index);
+            }
+        }
+        m_touched.clear();
+        if (m_active.empty()) {
+            m_levels.pop_back();
+            return false;
+        }
+        return true;
+    }
+
+    /// The transfers between V2 and the vessel with `amount` of `volume` in the row, `row_of(amount)` gives the row
+    /// with its amount changed
+    template <typename RowOf>
+    void transfer_v2(const uint64_t *bits, unsigned amount, unsigned volume, RowOf &&row_of) {
+        const unsigned full2 = m_volumes[2];
+        if (amount > 0 && full2 > 0) { // To V2, all of it fits up to full2 - amount, V2 gets full above
+            if (amount <= full2) {
+                or_shifted(row_of(0), bits, 0, full2 - amount, int(amount));
+            }
+            for_each_bit(bits, amount <= full2 ? full2 - amount + 1 : 0, full2 - 1,
+                         [&](unsigned level) { set_bit(row_of(amount - (full2 - level)), full2); });
+        }
+        if (amount < volume) { // From V2, all of it fits up to the room left, the vessel gets full above
+            const unsigned room = volume - amount;
+            for_each_bit(bits, 1, std::min(room, full2), [&](unsigned level) { set_bit(row_of(amount + level), 0); });
+            if (room < full2) {
+                or_shifted(row_of(volume), bits, room + 1, full2, -int(room));
+            }
+        }
+    }
+
+    void touch(size_t index) {
+        if (m_is_touched[index] == 0) {
+            m_is_touched[index] = 1;
+            m_touched.push_back(static_cast<uint32_t>(index));
+        }
+    }
+
+    void or_row(size_t index, const uint64_t *bits) {
+        touch(index);
+        uint64_t *target = &m_next[index * m_words];
+        for (size_t word = 0; word != m_words; ++word) {
+            target[word] |= bits[word];
+        }
+    }
+
+    void set_bit(size_t index, unsigned bit) {
+        touch(index);
+        m_next[index * m_words + bit / 64] |= uint64_t(1) << (bit % 64);
+    }
+
+    /// OR the bits [first, last] of `bits` into the row at [first + shift, last + shift]
+    void or_shifted(size_t index, const uint64_t *bits, unsigned first, unsigned last, int shift) {
+        if (first > last) {
+            return;
+        }
+        touch(index);
+        uint64_t *target = &m_next[index * m_words];
+        const auto low = static_cast<unsigned>(int(first) + shift);
+        const auto high = static_cast<unsigned>(int(last) + shift);
+        for (unsigned word = low / 64; word <= high / 64; ++word) {
+            const int from = int(word * 64) - shift; // Source bit of the word's bit 0
+            uint64_t window = 0;
+            if (from >= 0) {
+                const auto start = static_cast<unsigned>(from);
+                window = bits[start / 64] >> (start % 64);
+                if (start % 64 != 0 && start / 64 + 1 < m_words) {
+                    window |= bits[start / 64 + 1] << (64 - start % 64);
+                }
+            } else { // Only for a shift left into word 0
+                window = bits[0] << static_cast<unsigned>(-from);
+            }
+            target[word] |= window & range_mask(word, low, high);
+        }
+    }
+
+    /// The bits of the word in [low, high] of a row
+    [[nodiscard]]
+    static constexpr uint64_t range_mask(unsigned word, unsigned low, unsigned high) noexcept {
+        const unsigned first = std::max(low, word * 64) - word * 64;
+        const unsigned last = std::min(high, word * 64 + 63) - word * 64;
+        return (~uint64_t(0) >> (63 - last)) & (~uint64_t(0) << first);
+    }
+
+    [[nodiscard]]
+    bool any_bit(const uint64_t *bits, unsigned first, unsigned last) const noexcept {
+        for (unsigned word = first / 64; first <= last && word <= last / 64; ++word) {
+            if ((bits[word] & range_mask(word, first, last)) != 0) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    template <typename Visit>
+    void for_each_bit(const uint64_t *bits, unsigned first, unsigned last, Visit &&visit) const {
+        for (unsigned word = first / 64; first <= last && word <= last / 64; ++word) {
+            for (uint64_t rest = bits[word] & range_mask(word, first, last); rest != 0; rest &= rest - 1) {
+                visit(word * 64 + unsigned(std::countr_zero(rest)));
+            }
+        }
+    }
+};
+
+static_assert(LevelBitmapSolver::fits(VesselsState{1000, 1201, 1999}) == false);
+static_assert(LevelBitmapSolver::fits(VesselsState{100, 171, 222}));
@@ -0,0 +1,235 @@
+#pragma once
+
+#include <algorithm>
+#include <compare>
+#include <cstddef>
+#include <cstdint>
+
+#include "utils.h"
+#include "vessels_state.h"
+
+/// N water vessel's levels in the BITS bit fields of a single 64 bit word, the first vessel highest. The state of the
+/// scalar A* search, BasicAStarSolver: the state is one register, the word order is the level order of the array, the
+/// hash is of the word and the successors are computed with word arithmetic and masks instead of branches. Only the
+/// hot operations are here, the rest is done by the BasicVesselsState of the same levels. It is not a state for
+/// BasicWaterPouringPuzzleSolver, whose successor batches, visited ids and symmetry work on the array.
+template <unsigned N = 3, typename Water = water>
+class BasicPackedState {
+    using Array = BasicVesselsState<N, Water>;
+
+public:
+    using Level = Water;
+    using Packed = uint64_t;
+
+    constexpr inline static const unsigned BITS = Array::BITS;
+    constexpr inline static const unsigned VESSELS = N;
+    constexpr inline static const unsigned MOVES = moves_count(N);
+    constexpr inline static const Packed NOT_PACKED = ~Packed(0); // The top bit of a state is clear
+
+    static_assert(N * BITS < 64, "The levels must fit in a word with a bit to spare");
+
+    /// A slot per candidate move, filled without branches, see next_states()
+    using NextStates = InlineVector<BasicPackedState, moves_count(N)>;
+
+private:
+    constexpr inline static const uint64_t FIELD = (uint64_t(1) << BITS) - 1;
+    constexpr inline static const uint64_t LOWS = [] { // The lowest bit of every field
+        uint64_t lows = 0;
+        for (unsigned vessel = 0; vessel != N; ++vessel) {
+            lows = lows << BITS | 1;
+        }
+        return lows;
+    }();
+    constexpr inline static const uint64_t HIGHS = LOWS << (BITS - 1); // The highest bit of every field
+    constexpr inline static const uint64_t REST = HIGHS - LOWS;         // All but the highest bit of every field
+
+    uint64_t m_word = 0;
+
+public:
+    constexpr BasicPackedState() noexcept = default;
+
+    template <typename... Levels>
+        requires(sizeof...(Levels) == N && (std::is_convertible_v<Levels, Water> && ...))
+    constexpr BasicPackedState(Levels... levels) noexcept {
+        ((m_word = m_word << BITS | static_cast<Water>(levels)), ...);
+    }
+
+    constexpr explicit BasicPackedState(const BasicVesselsState<N, Water> &state) noexcept {
+        unrolled<N>([&](unsigned vessel) { m_word |= uint64_t(state[vessel]) << shift(vessel); });
+    }
+
+    /// The levels as an array
+    constexpr explicit operator BasicVesselsState<N, Water>() const noexcept {
+        Array state;
+        unrolled<N>([&](unsigned vessel) { state[vessel] = (*this)[vessel]; });
+        return state;
+    }
+
+    constexpr auto operator<=>(const BasicPackedState &) const noexcept = default;
+
+    /// Hash for unordered containers, the word itself
+    constexpr size_t operator()(const BasicPackedState &state) const noexcept {
+        return fold(state.m_word);
+    }
+
+    [[nodiscard]]
+    constexpr Water operator[](unsigned vessel) const noexcept {
+        return static_cast<Water>(m_word >> shift(vessel) & FIELD);
+    }
+
+    /// The word, the first vessel in the highest field
+    [[nodiscard]]
+    constexpr Packed packed() const noexcept {
+        return m_word;
+    }
+
+    /// Inverse of packed()
+    [[nodiscard]]
+    static constexpr BasicPackedState unpacked(Packed packed) noexcept {
+        BasicPackedState state;
+        state.m_word = packed;
+        return state;
+    }
+
+    [[nodiscard]]
+    constexpr uint64_t surface_size() const noexcept {
+        return levels().surface_size();
+    }
+
+    [[nodiscard]]
+    constexpr bool on_surface(const BasicPackedState &volumes) const noexcept {
+        return levels().on_surface(volumes.levels());
+    }
+
+    [[nodiscard]]
+    constexpr uint64_t surface_rank(const BasicPackedState &volumes) const noexcept {
+        return levels().surface_rank(volumes.levels());
+    }
+
+    /// Return new state after transferring water, the smaller of the source level and the free space moves
+    [[nodiscard]]
+    constexpr BasicPackedState transfer(unsigned src, unsigned dst, const BasicPackedState &volumes) const noexcept {
+        const uint64_t amount = std::min<uint64_t>((*this)[src], volumes[dst] - (*this)[dst]);
+        return unpacked(m_word - (amount << shift(src)) + (amount << shift(dst)));
+    }
+
+    /// All possible next states in the order of BasicVesselsState::next_states(). Every candidate move is computed and
+    /// stored, the empty and the full vessels are found for all of them at once and decide which are kept.
+    [[nodiscard]]
+    constexpr NextStates next_states(const BasicPackedState &volumes) const noexcept {
+        const uint64_t empty = zero_fields(m_word);
+        const uint64_t full = zero_fields(m_word ^ volumes.m_word);
+        NextStates result;
+        unrolled<N>([&](unsigned from) {
+            const uint64_t field = FIELD << shift(from);
+            const bool has_water = (empty & field) == 0;
+            result.push_back_if(unpacked(m_word | (volumes.m_word & field)), !has_water); // Fill
+            result.push_back_if(unpacked(m_word & ~field), has_water);                    // Drain
+            unrolled<N>([&](unsigned to) {
+                if (from != to) {
+                    result.push_back_if(transfer(from, to, volumes), has_water && (full & FIELD << shift(to)) == 0);
+                }
+            });
+        });
+        return result;
+    }
+
+    /// Reverse move generator, see BasicVesselsState::for_each_prev()
+    template <typename Visitor>
+    constexpr void for_each_prev(Move move, const BasicPackedState &volumes, Visitor &&visit) const {
+        levels().for_each_prev(move, volumes.levels(), [&](const Array &prev) { visit(BasicPackedState(prev)); });
+    }
+
+    // Do we contain the specified volume of water in any vessel?
+    [[nodiscard]]
+    constexpr bool contains(Water volume) const noexcept {
+        return zero_fields(m_word ^ volume * LOWS) != 0;
+    }
+
+    /// Every level multiplied by the factor
+    [[nodiscard]]
+    constexpr BasicPackedState scaled(Water factor) const noexcept {
+        return BasicPackedState(levels().scaled(factor));
+    }
+
+    /// Every level divided by the divisor, it must divide all of them
+    [[nodiscard]]
+    constexpr BasicPackedState divided(Water divisor) const noexcept {
+        return BasicPackedState(levels().divided(divisor));
+    }
+
+private:
+    [[nodiscard]]
+    constexpr Array levels() const noexcept {
+        return static_cast<Array>(*this);
+    }
+
+    static constexpr unsigned shift(unsigned vessel) noexcept {
+        return (N - 1 - vessel) * BITS;
+    }
+
+    /// The highest bit of every field of the word that is 0. Without the highest bit a field plus REST carries into it
+    /// only if it is not 0 and never out of the field.
+    static constexpr uint64_t zero_fields(uint64_t word) noexcept {
+        return ~(((word & REST) + REST) | word) & HIGHS;
+    }
+};
+
+/// The classic three vessels in a word
+using PackedState = BasicPackedState<3>;
+
+// "Unit test" for C++20 and above, the same order as VesselsState
+#if __cplusplus >= 202002L
+static_assert(PackedState{1, 2, 3} == PackedState{1, 2, 3});
+static_assert(PackedState{1, 2, 3} != PackedState{2, 2, 3});
+static_assert(PackedState{1, 2, 8} != PackedState{1, 2, 3});
+static_assert(PackedState{1, 2, 3} < PackedState{1, 2, 4});
+static_assert(PackedState{2, 2, 3} > PackedState{1, 2, 4});
+static_assert(PackedState{1, 65535, 65535} < PackedState{2, 0, 0});
+static_assert(PackedState{1, 2, 3}.packed() == 0x0001'0002'0003 && PackedState{1, 2, 3}[2] == 3);
+static_assert(PackedState(VesselsState{3, 5, 8}) == PackedState{3, 5, 8});
+static_assert(static_cast<VesselsState>(PackedState{3, 5, 8}) == VesselsState{3, 5, 8});
+static_assert(PackedState{3, 0, 8}.contains(0) && PackedState{3, 0, 8}.contains(8) &&
+              !PackedState{3, 0, 8}.contains(5));
+static_assert(PackedState{256, 1, 0}.contains(0) && !PackedState{256, 1, 1}.contains(0)); // No borrows between fields
+static_assert(PackedState{0, 5, 3}.transfer(1, 2, PackedState{3, 5, 8}) == PackedState{0, 0, 8});
+static_assert(PackedState{0, 5, 6}.transfer(1, 2, PackedState{3, 5, 8}) == PackedState{0, 3, 8});
+static_assert(PackedState{12, 255, 0}.surface_rank(PackedState{12, 255, 256}) ==
+              VesselsState{12, 255, 0}.surface_rank(VesselsState{12, 255, 256}));
+static_assert([] { // The successors of every state are the ones of the array, in the same order
+    for (const VesselsState volumes : {VesselsState{3, 5, 8}, VesselsState{0, 1, 2}, VesselsState{4, 7, 1}}) {
+        for (uint64_t rank = 0; rank != volumes.surface_size(); ++rank) {
+            const VesselsState state = VesselsState::surface_unrank(rank, volumes);
+            const auto expected = state.next_states(volumes);
+            const auto packed = PackedState(state).next_states(PackedState(volumes));
+            if (packed.size() != expected.size() || PackedState(state).contains(1) != state.contains(1)) {
+                return false;
+            }
+            for (size_t idx = 0; idx != packed.size(); ++idx) {
+                if (static_cast<VesselsState>(packed[idx]) != expected[idx]) {
+                    return false;
+                }
+            }
+        }
+    }
+    return true;
+}());
+static_assert([] { // Equality and order are the ones of the arrays for every pair of states in a box
+    const VesselsState volumes{2, 3, 4};
+    for (uint64_t lhs = 0; lhs != volumes.box_size(); ++lhs) {
+        const VesselsState first{lhs / 20, lhs / 5 % 4, lhs % 5};
+        for (uint64_t rhs = 0; rhs != volumes.box_size(); ++rhs) {
+            const VesselsState second{rhs / 20, rhs / 5 % 4, rhs % 5};
+            const PackedState packed{first};
+            if ((packed <=> PackedState(second)) != (first <=> second) ||
+                (packed == PackedState(second)) != (first == second) || static_cast<VesselsState>(packed) != first) {
+                return false;
+            }
+        }
+    }
+    return true;
+}());
+static_assert(BasicPackedState<7, uint8_t>{1, 2, 3, 4, 5, 6, 255}.contains(255));
+static_assert(BasicPackedState<7, uint8_t>{1, 2, 3, 4, 5, 6, 7}.next_states(
+                  BasicPackedState<7, uint8_t>{9, 9, 9, 9, 9, 9, 9}).size() == 7 + 7 * 6);
+#endif
@@ -0,0 +1,807 @@
+#pragma once
+
+#include <algorithm>
+#include <cassert>
+#include <cstdint>
+#include <cstdio>
+#include <exception>
+#include <fmt/core.h>
+#include <memory>
+#include <string>
+#include <type_traits>
+#include <unordered_map>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+
+#include "analytic.h"
+#include "hash.h"
+#include "history.h"
+#include "successors.h"
+#include "symmetry.h"
+#include "thread_pool.h"
+#include "utils.h"
+#include "vessels_state.h"
+#include "visited.h"
+
+/// What the solver remembers to rebuild the solution path
+enum class Tracking {
+    parents,  // Every discovered state and the history index of the state it was discovered from
+    moves,    // Move code and depth residue per state id and only the last two BFS levels, needs a dense layout
+    frontier, // Only the visited states and the last two BFS levels, the path is searched for again by its midpoints
+    depths,   // Depth modulo 3 per state id in 2 bits and the last two BFS levels, pruning the midpoint searches
+};
+
+/// A Solution per amount of water, a vector indexed by the amount if the volumes are small, a hash map of the amounts
+/// seen otherwise, a search of big volumes never gets to most of them
+template <typename Water, typename Solution>
+class AmountTable {
+    constexpr inline static const uint64_t DENSE_LIMIT = uint64_t(1) << 20;
+
+    std::vector<Solution> m_dense{};
+    std::unordered_map<Water, Solution> m_sparse{};
+
+public:
+    /// Forget all the solutions, for amounts up to `largest`
+    void reset(Water largest) {
+        if (largest < DENSE_LIMIT) {
+            m_dense.assign(size_t(largest) + 1, Solution{});
+            m_sparse = {};
+        } else {
+            m_dense = {};
+            m_sparse.clear();
+        }
+    }
+
+    /// The solution of the amount, added as not found yet if there is none
+    Solution &operator[](Water amount) {
+        return m_dense.empty() ? m_sparse[amount] : m_dense[amount];
+    }
+
+    /// The solution of the amount, not found if there is none or it is out of range
+    [[nodiscard]]
+    Solution find(Water amount) const {
+        if (!m_dense.empty()) {
+            return amount < m_dense.size() ? m_dense[amount] : Solution{};
+        }
+        const auto found = m_sparse.find(amount);
+        return found == m_sparse.end() ? Solution{} : found->second;
+    }
+};
+
+/// Solve the water pouring puzzle of N vessels with tap, sink and empty initial state. The levels are of the Water
+/// type, see BasicVesselsState. The Hash policy is for the sparse layout.
+/// If some vessels have the same volume and the parents are tracked, only the canonical state of those that differ by
+/// swapping them is searched, see Symmetry, and the paths are unfolded back to the actual moves.
+template <unsigned N = 3, typename Water = water, typename Hash = MixHash>
+class BasicWaterPouringPuzzleSolver {
+public:
+    using State = BasicVesselsState<N, Water>;
+    using History = BasicHistory<State>;
+    using Index = typename History::Index;
+
+protected:
+    constexpr inline static const size_t HISTORY_RESERVE_LIMIT = size_t(1) << 24;
+    constexpr inline static const int64_t NO_TARGET = -1; // Search until all reachable states are discovered
+    constexpr inline static const int NO_BOUND = -1;  // Search as deep as needed
+    constexpr inline static const int BOUNDED = -2;   // The search reached the bound, nothing shorter
+    constexpr inline static const uint64_t PARALLEL_LEVEL_MIN = 1U << 14; // Smaller levels are not worth the threads
+    constexpr inline static const unsigned PARALLEL_PARTS = 4; // Slices of a level per thread, the pool balances them
+    constexpr inline static const uint64_t ANALYTIC_MIN = 1U << 20; // Smaller id spaces are searched, same paths
+    constexpr inline static const Index ANALYTIC = History::NO_PARENT - 1; // Solution index of m_analytic
+    constexpr inline static const bool MOVE_CODES = State::MOVES <= MoveTable::START; // Fit in the move table
+
+    /// A new state and the history index of the state it was discovered from
+    struct Discovery {
+        State state;
+        Index parent;
+    };
+
+public:
+    /// The shortest way found to measure an amount of water
+    struct Solution {
+        int steps = -1;                            // -1 if not measurable
+        State state{};                             // The state the solution ends with
+        Index index = History::NO_PARENT;          // Its history index
+    };
+
+protected:
+    Water m_scale;                          // The common divisor of the volumes
+    State m_volumes;                        // Divided by m_scale, the search and all the states use these
+    Layout m_layout;                        // How the visited states are stored
+    Tracking m_tracking;                    // How the solution path is remembered
+    Symmetry<State> m_symmetry{};           // Of the vessels with equal volumes, the states searched are canonical
+    unsigned m_threads;                     // Threads expanding a BFS level, 1 is the serial engine
+    History m_history{};                    // State discovery history, only the BFS queue if not tracking parents
+    Visited<State, Hash> m_visited{};       // States visited
+    MoveTable m_moves{};                    // Used if tracking moves
+    DepthTable m_depths{};                  // Used if tracking depths
+    std::vector<Index> m_levels{};          // History index where each complete BFS level ends
+    Index m_expand = 0;                     // History index of the next state to expand
+    AmountTable<Water, Solution> m_table{}; // Per amount of water, filled by scan()
+    Index m_scanned = 0;                    // History index of the next state to scan()
+    size_t m_scan_level = 0;                // BFS level of m_scanned
+    Solution m_solution{};                  // The last solution found by solve()
+    std::vector<std::vector<Discovery>> m_buffers{};          // Per slice new states of the parallel engine
+    std::vector<BasicSuccessorBatch<N, Water>> m_batches{};   // Per pool worker ones of the parallel engine
+    std::unique_ptr<WorkStealingPool> m_pool{};               // The threads of the parallel engine, made when needed
+    BasicSuccessorBatch<N, Water> m_batch{};                  // The states being expanded by the serial engine
+    std::vector<State> m_analytic{};                 // The path of the last solution if found without a search
+
+public:
+    /// More than one thread expands each big BFS level in parallel, the step counts are the same, the solution path can
+    /// differ (any of the parents of a state may claim it first). Only with a dense layout, serial otherwise.
+    explicit BasicWaterPouringPuzzleSolver(const State &volumes, Layout layout = Layout::automatic,
+                                           Tracking tracking = Tracking::parents, unsigned threads = 1)
+        : m_scale(common_divisor(volumes)), m_volumes(volumes.divided(m_scale)), m_layout(layout), m_tracking(tracking),
+          m_threads(std::max(threads, 1U)) {}
+
+    /// The greatest common divisor of the volumes, 1 if all are 0. Any amount of water that can be measured and every
+    /// state on the way is a multiple of it, the puzzle divided by it has the same solutions in a box scale^N smaller.
+    [[nodiscard]]
+    static constexpr Water common_divisor(const State &volumes) noexcept {
+        Water divisor = 0;
+        for (const Water volume : volumes) {
+            divisor = gcd(divisor, volume);
+        }
+        return divisor == 0 ? 1 : divisor;
+    }
+
+    /// Can the target be measured at all? The feasibility oracle, no search and no memory needed.
+    /// Every level is a multiple of the common divisor and no vessel holds more than the biggest one, every such amount
+    /// is reachable with at least two vessels. With a single vessel (the others have no volume) the only state holding
+    /// its volume is the full one, the search never enters it, so only 0 is measurable.
+    [[nodiscard]]
+    static constexpr bool measurable(const State &volumes, Water target) noexcept {
+        if (target == 0) {
+            return true;
+        }
+        const auto vessels = std::count_if(volumes.begin(), volumes.end(), [](Water volume) { return volume != 0; });
+        return vessels >= 2 && target <= *std::max_element(volumes.begin(), volumes.end()) &&
+               target % common_divisor(volumes) == 0;
+    }
+
+    /// Returns in how many steps it can be solved (and prints it), -1 is no solution
+    int solve_water(const Water target) {
+        if (target == 0) {
+            puts("All vessels are empty initially, all have 0 liters of water, 0 steps!");
+            return 0;
+        }
+
+        const int steps = solve(target);
+        show(target, steps);
+        return steps;
+    }
+
+    /// Returns in how many steps it can be solved, -1 is no solution, see path() for the solution.
+    /// The search is resumed from where the previous call stopped, nothing is expanded if the target was seen already.
+    int solve(const Water target) {
+        if (!measurable(volumes(), target)) {
+            m_solution = Solution{}; // Nothing to search for
+            return -1;
+        }
+        const auto reduced = static_cast<Water>(target / m_scale);
+        // An expensive search only has to beat the best vessel pairing, if that is not proven to be minimal already
+        PourAndRefill::Result analytic{};
+        if (m_volumes.surface_size() >= ANALYTIC_MIN) {
+            analytic = PourAndRefill::solve(m_volumes, reduced);
+            if (analytic.minimal) {
+                return solve_analytic(reduced, analytic);
+            }
+        }
+        start();
+        scan();
+        if (m_table.find(reduced).steps >= 0) {
+            m_solution = m_table.find(reduced);
+            return m_solution.steps;
+        }
+
+        m_solution = Solution{};
+        const int bound = analytic.steps < 0 ? NO_BOUND : analytic.steps;
+        m_solution.steps = parallel() ? expand_levels(reduced, bound) : expand(reduced, bound);
+        if (m_solution.steps == BOUNDED) { // All the shallower levels are searched, the pairing is minimal
+            return solve_analytic(reduced, analytic);
+        }
+        return m_solution.steps;
+    }
+
+    /// Run the search until every reachable state is discovered, find the shortest solution of every amount from 0 to
+    /// the biggest volume, the queries are then just a look up, see solution() and path(const Solution &)
+    void solve_all() {
+        start();
+        if (parallel()) {
+            expand_levels(NO_TARGET, NO_BOUND);
+        } else {
+            expand(NO_TARGET, NO_BOUND);
+        }
+        scan();
+    }
+
+    /// Forget the search, the next solve starts from the initial state again
+    void reset() noexcept {
+        m_levels.clear();
+    }
+
+    /// Forget the search and switch to other vessels, the memory already allocated is reused
+    void reset(const State &volumes) noexcept {
+        m_scale = common_divisor(volumes);
+        m_volumes = volumes.divided(m_scale);
+        m_levels.clear();
+    }
+
+    /// The volumes as given
+    [[nodiscard]]
+    State volumes() const noexcept {
+        return m_volumes.scaled(m_scale);
+    }
+
+    /// The shortest solution for the amount, valid after solve_all()
+    [[nodiscard]]
+    Solution solution(Water target) const {
+        if (!measurable(volumes(), target)) {
+            return {};
+        }
+        return scaled(m_table.find(static_cast<Water>(target / m_scale)));
+    }
+
+    /// Number of states discovered so far
+    [[nodiscard]]
+    size_t discovered() const noexcept {
+        return m_history.size();
+    }
+
+    /// The states of the last solution, from the initial one to the goal
+    [[nodiscard]]
+    std::vector<State> path() const {
+        return path(scaled(m_solution));
+    }
+
+    /// The states of a solution, from the initial one to the goal
+    [[nodiscard]]
+    std::vector<State> path(Solution solution) const {
+        if (solution.steps < 0) {
+            return {};
+        }
+        solution.state = solution.state.divided(m_scale);
+        std::vector<State> states;
+        if (solution.index == ANALYTIC) {
+            states = m_analytic;
+        } else if (m_history.parents()) {
+            states = m_symmetry.unfolded(path_from_parents(solution), m_volumes);
+        } else if (m_tracking == Tracking::moves) {
+            states = path_from_moves(solution);
+        } else {
+            states = m_symmetry.unfolded(path_from_frontier(solution), m_volumes);
+        }
+        for (State &state : states) {
+            state = state.scaled(m_scale);
+        }
+        return states;
+    }
+
+protected:
+    /// Initialize the search on the first call, keep the discovered levels and the frontier afterwards
+    void start() {
+        if (!m_levels.empty()) {
+            return;
+        }
+        // Sized once from the volumes, a bitmap if the id space is small enough. The move and depth tables are sized
+        // from the id space too, so prefer the smallest one over the cheapest ids, sparse if even that is too big.
+        const bool tables = m_tracking == Tracking::moves || m_tracking == Tracking::depths;
+        const Layout layout = tables && m_layout == Layout::automatic ? Layout::surface : m_layout;
+        m_visited.reset(m_volumes, Visited<State, Hash>::resolve(m_volumes, layout));
+        // Move codes and depths are keyed by the dense state id, use the parents with a hash set or too many moves for
+        // the move table
+        const bool moves = MOVE_CODES && m_tracking == Tracking::moves && m_visited.dense();
+        const bool depths = m_tracking == Tracking::depths && m_visited.dense();
+        const bool parents = !moves && !depths && m_tracking != Tracking::frontier;
+        m_moves.reset(moves ? m_visited.capacity() : 0);
+        m_depths.reset(depths ? m_visited.capacity() : 0);
+        // Save some memory allocations, all reachable states are on the surface
+        const uint64_t reachable = m_volumes.surface_size();
+        const uint64_t reserve =
+            m_visited.dense() && parents ? std::min<uint64_t>(reachable, HISTORY_RESERVE_LIMIT) : 256;
+        m_history.reset(reachable, reserve, parents);
+        // The recorded moves lead to the actual successors, walking them back needs those
+        m_symmetry = moves ? Symmetry<State>{} : Symmetry<State>{m_volumes};
+
+        m_table.reset(*std::max_element(m_volumes.begin(), m_volumes.end()));
+        m_scanned = 0;
+        m_scan_level = 0;
+
+        m_visited.insert(State{});   // We don't want to empty all of them
+        m_visited.insert(m_volumes); // We also don't want to fill all of them
+
+        m_history.push_back(State{}, History::NO_PARENT); // Initial state, level 0
+        record(State{}, MoveTable::START, 0);
+        m_levels.assign(1, m_history.size());
+        m_expand = 0;
+    }
+
+    /// Expand the states level by level, returns the steps to the first new state containing the target, -1 when there
+    /// are no new states left or BOUNDED before discovering states `bound` steps away
+    int expand(const int64_t target, const int bound) {
+        while (true) {
+            if (bound != NO_BOUND && static_cast<int>(m_levels.size()) >= bound) {
+                return BOUNDED; // The new states would be that deep
+            }
+            const Index level_end = m_levels.back();
+            if (m_expand == level_end) { // The next level is complete
+                if (m_history.size() == level_end) {
+                    return -1; // No new state transitions possible, no solution
+                }
+                m_levels.push_back(m_history.size());
+                if (!m_history.parents()) { // Only the new level is needed from now on
+                    scan();
+                    m_history.drop_front(level_end);
+                }
+                continue;
+            }
+
+            const auto step = static_cast<int>(m_levels.size()); // The new states are one level deeper
+            const Index first = m_expand;
+            const Index last = std::min<Index>(level_end, first + m_batch.SIZE);
+            m_batch.clear();
+            for (Index idx = first; idx != last; ++idx) {
+                m_batch.push_back(m_history.state(idx)); // copy, the history may grow
+            }
+            m_batch.expand(m_volumes, target);
+            const unsigned first_goal = m_batch.first_goal();
+            prefetch(m_batch);
+            for (; m_expand != last; ++m_expand) {
+                const auto lane = static_cast<unsigned>(m_expand - first);
+                for (unsigned order = 0; order != State::MOVES; ++order) {
+                    const Move move = m_batch.ORDER[order];
+                    if (!m_batch.valid(move, lane)) {
+                        continue;
+                    }
+                    const State next = m_symmetry.canonical(m_batch.state(move, lane));
+                    if (!m_visited.insert(next)) {
+                        continue;
+                    }
+                    m_history.push_back(next, m_expand);
+                    record(next, static_cast<uint8_t>(move), step);
+
+                    if (lane * State::MOVES + order >= first_goal && m_batch.goal(move, lane)) {
+                        // m_expand is not advanced, the next call goes on with the rest of its successors
+                        m_solution.state = next;
+                        m_solution.index = m_history.size() - 1;
+                        return step;
+                    }
+                }
+            }
+        }
+    }
+
+    /// Take the minimal two vessel pour and refill solution, returns its steps
+    int solve_analytic(const Water target, const PourAndRefill::Result &analytic) {
+        assert(analytic.steps >= 0);
+        m_analytic = PourAndRefill::path(m_volumes, target, analytic);
+        m_solution = {analytic.steps, m_analytic.back(), ANALYTIC};
+        return m_solution.steps;
+    }
+
+    /// The solution with the levels as given
+    [[nodiscard]]
+    Solution scaled(Solution solution) const noexcept {
+        solution.state = solution.state.scaled(m_scale);
+        return solution;
+    }
+
+    [[nodiscard]]
+    bool parallel() const noexcept {
+        return m_threads > 1 && m_visited.dense();
+    }
+
+    /// The parallel engine, expand whole levels until the target is found, returns like expand()
+    int expand_levels(const int64_t target, const int bound) {
+        while (bound == NO_BOUND || static_cast<int>(m_levels.size()) < bound) {
+            if (!expand_level()) {
+                return -1;
+            }
+            scan(); // Has the new level the target?
+            if (target != NO_TARGET && m_table.find(static_cast<Water>(target)).steps >= 0) {
+                m_solution = m_table.find(static_cast<Water>(target));
+                return m_solution.steps;
+            }
+        }
+        return BOUNDED;
+    }
+
+    /// Expand the rest of the current level on m_threads threads. The frontier is cut into contiguous slices, a slice
+    /// is expanded by the successor batches like in expand(), the new states are claimed in the shared bitmap and kept
+    /// in its own buffer. The buffer sizes are then summed up into offsets, the history grows on this thread and the
+    /// buffers are copied to their places in it, so the new level is in frontier order. The first exception of a slice
+    /// is thrown here once all are done. Returns false if no new states were found.
+    bool expand_level() {
+        const Index level_begin = m_expand;
+        const Index level_end = m_levels.back();
+        const uint64_t count = level_end - level_begin;
+        const size_t parts = count < PARALLEL_LEVEL_MIN ? 1 : size_t(m_threads) * PARALLEL_PARTS;
+        const auto step = static_cast<int>(m_levels.size());
+        m_buffers.resize(std::max(m_buffers.size(), parts));
+        m_batches.resize(m_threads);
+        if (parts != 1 && !m_pool) {
+            m_pool = std::make_unique<WorkStealingPool>(m_threads);
+        }
+        const auto run = [&](const auto &task) {
+            if (parts == 1) {
+                task(0, 0);
+                return;
+            }
+            std::vector<std::exception_ptr> errors(parts);
+            m_pool->run(parts, [&](unsigned worker, size_t part) {
+                try {
+                    task(worker, part);
+                } catch (...) {
+                    errors[part] = std::current_exception();
+                }
+            });
+            for (const std::exception_ptr &error : errors) {
+                if (error) {
+                    std::rethrow_exception(error);
+                }
+            }
+        };
+
+        run([&](unsigned worker, size_t part) {
+            BasicSuccessorBatch<N, Water> &batch = m_batches[worker];
+            std::vector<Discovery> &buffer = m_buffers[part];
+            buffer.clear();
+            const Index end = level_begin + count * (part + 1) / parts;
+            for (Index first = level_begin + count * part / parts; first < end; first += batch.SIZE) {
+                const Index last = std::min<Index>(end, first + batch.SIZE);
+                batch.clear();
+                for (Index idx = first; idx != last; ++idx) {
+                    batch.push_back(m_history.state(idx));
+                }
+                batch.expand(m_volumes); // The goal is looked for by scan() once the level is complete
+                prefetch(batch);
+                for (unsigned lane = 0; lane != batch.size(); ++lane) {
+                    for (const Move move : batch.ORDER) {
+                        if (!batch.valid(move, lane)) {
+                            continue;
+                        }
+                        const State state = m_symmetry.canonical(batch.state(move, lane));
+                        if (m_visited.insert_atomic(state)) {
+                            buffer.push_back({state, first + lane});
+                            record(state, static_cast<uint8_t>(move), step, true); // Own id, no race for moves
+                        }
+                    }
+                }
+            }
+        });
+
+        std::vector<Index> offsets(parts + 1, level_end);
+        for (size_t part = 0; part != parts; ++part) {
+            offsets[part + 1] = offsets[part] + m_buffers[part].size();
+        }
+        m_history.grow(offsets[parts] - level_end);
+        run([&](unsigned /*worker*/, size_t part) {
+            const std::vector<Discovery> &buffer = m_buffers[part];
+            for (size_t i = 0; i != buffer.size(); ++i) {
+                m_history.set(offsets[part] + i, buffer[i].state, buffer[i].parent);
+            }
+        });
+
+        m_expand = level_end;
+        if (m_history.size() == level_end) {
+            return false; // No new state transitions possible
+        }
+        m_levels.push_back(m_history.size());
+        if (!m_history.parents()) { // Only the new level is needed from now on
+            scan();
+            m_history.drop_front(level_end);
+        }
+        return true;
+    }
+
+    /// Start the visited lookups of the successors in a batch all at once, unless the layout is small enough to cache
+    void prefetch(const BasicSuccessorBatch<N, Water> &batch) const noexcept {
+        if (m_visited.layout() == Layout::box) {
+            return;
+        }
+        for (unsigned lane = 0; lane != batch.size(); ++lane) {
+            for (const Move move : batch.ORDER) {
+                if (batch.valid(move, lane)) {
+                    m_visited.prefetch(m_symmetry.canonical(batch.state(move, lane)));
+                }
+            }
+        }
+    }
+
+    /// Record the states discovered since the last scan in the per amount table, in discovery order, so the first
+    /// state with an amount is on a shortest path
+    void scan() {
+        for (; m_scanned < m_history.size(); ++m_scanned) {
+            while (m_scan_level < m_levels.size() && m_scanned >= m_levels[m_scan_level]) {
+                ++m_scan_level;
+            }
+            const State &state = m_history.state(m_scanned);
+            for (const Water amount : state) {
+                if (m_table[amount].steps < 0) {
+                    m_table[amount] = {static_cast<int>(m_scan_level), state, m_scanned};
+                }
+            }
+        }
+    }
+
+    /// Remember how a newly discovered state was reached, `concurrent` from several threads at once
+    void record(const State &state, uint8_t move, int depth, bool concurrent = false) {
+        if (m_history.parents()) {
+            return;
+        }
+        if (m_tracking == Tracking::moves) {
+            m_moves.set(m_visited.id(state), move, static_cast<unsigned>(depth));
+        } else if (m_tracking == Tracking::depths) {
+            if (concurrent) {
+                m_depths.set_atomic(m_visited.id(state), static_cast<unsigned>(depth));
+            } else {
+                m_depths.set(m_visited.id(state), static_cast<unsigned>(depth));
+            }
+        }
+    }
+
+    /// Walk the parent indices back from the goal
+    [[nodiscard]]
+    std::vector<State> path_from_parents(const Solution &goal) const {
+        assert(!m_history.empty());
+        std::vector<State> solution;
+        solution.resize(static_cast<size_t>(goal.steps) + 1);
+
+        Index history_idx = goal.index;
+        for (int pos = goal.steps; pos != -1; --pos) {
+            solution.at(static_cast<size_t>(pos)) = m_history.state(history_idx); // Save current
+            history_idx = m_history.parent(history_idx);                         // travel back
+
+            if (pos == 0) {
+                assert(history_idx == History::NO_PARENT);
+            } else {
+                assert(history_idx != History::NO_PARENT);
+            }
+        }
+        return solution;
+    }
+
+    /// Rebuild the path from the move codes, walking back from the goal through the discovered predecessors by the
+    /// recorded move, one level shallower by the depth residue. That is exact unless the solution is longer than
+    /// MoveTable::DEPTHS, so it is a depth first search that must reach the initial state in exactly `steps` moves,
+    /// with dead ends remembered per level.
+    [[nodiscard]]
+    std::vector<State> path_from_moves(const Solution &goal) const {
+        const auto steps = static_cast<size_t>(goal.steps);
+        struct Frame {
+            State state;
+            std::vector<State> prevs; // Discovered predecessors by the recorded move
+            size_t next;              // The next one to try
+        };
+        const auto prevs = [this](const State &state) {
+            std::vector<State> result;
+            const uint64_t state_id = m_visited.id(state);
+            const uint8_t move = m_moves.move(state_id);
+            if (move < State::MOVES) {
+                const unsigned depth = (m_moves.depth(state_id) + MoveTable::DEPTHS - 1) % MoveTable::DEPTHS;
+                state.for_each_prev(static_cast<Move>(move), m_volumes, [&](const State &prev) {
+                    if (!m_visited.contains(prev)) {
+                        return;
+                    }
+                    const uint64_t prev_id = m_visited.id(prev);
+                    if (m_moves.move(prev_id) != MoveTable::NONE && m_moves.depth(prev_id) == depth) {
+                        result.push_back(prev);
+                    }
+                });
+            }
+            return result;
+        };
+
+        std::vector<std::unordered_set<uint64_t>> dead(steps + 1); // State ids per level
+        std::vector<Frame> stack;
+        stack.push_back({goal.state, prevs(goal.state), 0});
+        while (!stack.empty()) {
+            const size_t level = steps + 1 - stack.size();
+            Frame &top = stack.back();
+            if (level == 0 && top.state == State{}) {
+                break;
+            }
+            if (level == 0 || top.next == top.prevs.size()) {
+                dead[level].insert(m_visited.id(top.state));
+                stack.pop_back();
+                continue;
+            }
+            const State prev = top.prevs[top.next++];
+            if (dead[level - 1].count(m_visited.id(prev)) == 0) {
+                stack.push_back({prev, prevs(prev), 0});
+            }
+        }
+        assert(stack.size() == steps + 1);
+
+        std::vector<State> solution;
+        solution.reserve(stack.size());
+        for (auto frame = stack.rbegin(); frame != stack.rend(); ++frame) {
+            solution.push_back(frame->state);
+        }
+        return solution;
+    }
+
+    /// Rebuild the path with nothing recorded but the goal, Korf's divide and conquer: a search from the first state of
+    /// a stretch of the path to its last one tags the states of its middle level and they pass the tag on to the states
+    /// they discover, the tag the last state gets is on a shortest path. Both halves are rebuilt the same way, there
+    /// are about as many searches as steps and each one is at most as deep as its stretch is long. With the depth
+    /// residues the searches skip the states that cannot be on the path, see midpoint().
+    [[nodiscard]]
+    std::vector<State> path_from_frontier(const Solution &goal) const {
+        const auto steps = static_cast<size_t>(goal.steps);
+        std::vector<State> solution(steps + 1); // The initial state first
+        solution.back() = goal.state;
+        Visited<State, Hash> visited; // Reused by all the searches
+        std::vector<std::pair<size_t, size_t>> stretches{{0, steps}};
+        while (!stretches.empty()) {
+            const auto [first, last] = stretches.back();
+            stretches.pop_back();
+            if (last - first >= 2) {
+                const size_t middle = first + (last - first) / 2;
+                solution[middle] = midpoint(solution, first, last, middle, visited);
+                stretches.emplace_back(first, middle);
+                stretches.emplace_back(middle, last);
+            }
+        }
+        return solution;
+    }
+
+    /// The state of the shortest path at the `middle` step, between the ones at the `first` and `last` steps. A breadth
+    /// first search keeping only the level being expanded and the next one besides the visited states. A state first
+    /// reached `depth` steps after the first one is on the path only if it is `first + depth` steps from the initial
+    /// state, when tracking depths the ones with another residue are not expanded. The residue of a state that far
+    /// plus 3, 6, ... may match, a drain or a transfer can lead back up, so the search is still needed.
+    [[nodiscard]]
+    State midpoint(const std::vector<State> &solution, size_t first, size_t last, size_t middle,
+                   Visited<State, Hash> &visited) const {
+        const State &from = solution[first];
+        const State &to = solution[last];
+        const bool depths = m_tracking == Tracking::depths && first != 0; // From the initial state all are on level
+        struct Tagged {
+            State state;
+            State tag; // The ancestor in the middle level
+        };
+        visited.reset(m_volumes, m_visited.layout());
+        visited.insert(State{});   // Never entered again, as in the search
+        visited.insert(m_volumes); // Never entered
+        visited.insert(from);
+        std::vector<Tagged> level{{from, from}};
+        std::vector<Tagged> deeper;
+        for (size_t depth = first + 1; depth <= last; ++depth) {
+            const unsigned residue = static_cast<unsigned>(depth % DepthTable::DEPTHS);
+            deeper.clear();
+            for (const Tagged &tagged : level) {
+                for (const State next : tagged.state.next_states(m_volumes)) {
+                    const State state = m_symmetry.canonical(next);
+                    if (!visited.insert(state)) {
+                        continue;
+                    }
+                    const State tag = depth == middle ? state : tagged.tag;
+                    if (state == to) {
+                        assert(depth == last);
+                        return tag;
+                    }
+                    if (depths && !on_level(state, residue)) {
+                        continue;
+                    }
+                    deeper.push_back({state, tag});
+                }
+            }
+            level.swap(deeper);
+        }
+        assert(false); // The search found `to` that deep
+        return to;
+    }
+
+    /// Was the state discovered at a depth with the residue? Tracking depths only.
+    [[nodiscard]]
+    bool on_level(const State &state, unsigned residue) const noexcept {
+        const uint64_t state_id = m_visited.id(state);
+        return m_depths.discovered(state_id) && m_depths.depth(state_id) == residue;
+    }
+
+    /// Print the solution
+    void show(const Water target, int steps) {
+        if (steps <= 0) {
+            return;
+        }
+        print_path(volumes(), target, path());
+    }
+
+public:
+    /// Print the states of a solution path as a table
+    static void print_path(const State &volumes, const Water target, const std::vector<State> &path) {
+        fmt::print("Solved measure {} liters of water using {} vessels in {} steps\n", target, listed(volumes),
+                   path.size() - 1);
+        const size_t width = column_width(volumes);
+        const size_t step_width = std::max<size_t>(3, fmt::formatted_size("{}", path.size() - 1));
+        print_border("┌" + rule(step_width + 3), "┬", "┐", width);
+        print_row(fmt::format("│ {: <{}} ", "Step", step_width + 1), volumes, width);
+        print_border("├" + rule(step_width + 3), "┼", "┤", width);
+        for (size_t i = 0; i != path.size(); ++i) {
+            print_row(fmt::format("│ {: >{}}. ", i, step_width), path[i], width);
+        }
+        print_border("└" + rule(step_width + 3), "┴", "┘", width);
+    }
+
+    /// The volumes as text, "3, 5 and 8"
+    [[nodiscard]]
+    static std::string listed(const State &volumes) {
+        std::string text = fmt::format("{}", volumes[0]);
+        for (unsigned vessel = 1; vessel != N; ++vessel) {
+            text += fmt::format("{}{}", vessel + 1 == N ? " and " : ", ", volumes[vessel]);
+        }
+        return text;
+    }
+
+    /// Width of the level columns of a table, the digits of the biggest volume, at least 3
+    [[nodiscard]]
+    static size_t column_width(const State &volumes) {
+        return std::max<size_t>(3, fmt::formatted_size("{}", *std::max_element(volumes.begin(), volumes.end())));
+    }
+
+    /// A horizontal table line of `width` characters
+    [[nodiscard]]
+    static std::string rule(size_t width) {
+        std::string line;
+        for (size_t i = 0; i != width; ++i) {
+            line += "─";
+        }
+        return line;
+    }
+
+    /// Print a table border, `first` is the part before the vessel columns, `width` the one of their levels
+    static void print_border(const std::string &first, const char *cross, const char *last, size_t width) {
+        std::string line = first;
+        for (unsigned vessel = 0; vessel != N; ++vessel) {
+            line += cross;
+            line += rule(width + 2);
+        }
+        fmt::print("{}{}\n", line, last);
+    }
+
+    /// Print a table row, `first` is the part before the vessel columns, `width` the one of their levels
+    static void print_row(const std::string &first, const State &levels, size_t width) {
+        std::string line = first;
+        for (const Water level : levels) {
+            line += fmt::format("│ {: >{}} ", level, width);
+        }
+        fmt::print("{}│\n", line);
+    }
+};
+
+using WaterPouringPuzzleSolver = BasicWaterPouringPuzzleSolver<3>;
+
+static_assert(WaterPouringPuzzleSolver::measurable(VesselsState{3, 5, 8}, 4));
+static_assert(WaterPouringPuzzleSolver::measurable(VesselsState{3, 5, 8}, 0));
+static_assert(!WaterPouringPuzzleSolver::measurable(VesselsState{3, 5, 8}, 9));  // Too much
+static_assert(!WaterPouringPuzzleSolver::measurable(VesselsState{4, 6, 8}, 5));  // Not a multiple of 2
+static_assert(WaterPouringPuzzleSolver::measurable(VesselsState{0, 4, 6}, 2));
+static_assert(!WaterPouringPuzzleSolver::measurable(VesselsState{0, 0, 7}, 7)); // A single vessel
+static_assert(!WaterPouringPuzzleSolver::measurable(VesselsState{0, 0, 0}, 1));
+static_assert([] { // The oracle says yes for exactly the amounts a breadth first search finds
+    constexpr auto agrees = [](const auto &volumes) {
+        using State = std::remove_cvref_t<decltype(volumes)>;
+        const auto steps = reference_steps(volumes);
+        for (unsigned target = 0; target != steps.size(); ++target) {
+            const auto amount = static_cast<typename State::Level>(target);
+            if (BasicWaterPouringPuzzleSolver<State::VESSELS>::measurable(volumes, amount) != (steps[target] >= 0)) {
+                return false;
+            }
+        }
+        return true;
+    };
+    for (const VesselsState volumes : {VesselsState{3, 5, 8}, VesselsState{4, 6, 8}, VesselsState{0, 4, 6},
+                                       VesselsState{0, 0, 7}, VesselsState{2, 2, 2}, VesselsState{1, 1, 1},
+                                       VesselsState{0, 0, 0}, VesselsState{2, 6, 9}, VesselsState{6, 10, 12}}) {
+        if (!agrees(volumes)) {
+            return false;
+        }
+    }
+    return agrees(BasicVesselsState<2>{4, 6}) && agrees(BasicVesselsState<2>{3, 7}) &&
+           agrees(BasicVesselsState<2>{0, 5}) && agrees(BasicVesselsState<4>{2, 3, 4, 6}) &&
+           agrees(BasicVesselsState<4>{2, 2, 4, 0});
+}());
+static_assert(BasicWaterPouringPuzzleSolver<4>::common_divisor(BasicVesselsState<4>{4, 0, 6, 10}) == 2);
@@ -0,0 +1,239 @@
+#pragma once
+
+#include <array>
+#include <bit>
+#include <cassert>
+#include <cstdint>
+#include <cstring>
+
+#include "utils.h"
+#include "vessels_state.h"
+
+/// GCC vector of WIDTH levels, the attribute is lost on template arguments, so the vectors are kept in C arrays
+template <typename Water, unsigned WIDTH>
+struct LevelVectors {
+    typedef Water Type __attribute__((vector_size(WIDTH * sizeof(Water)))); // NOLINT(modernize-use-using)
+};
+
+/// The successors of a batch of up to SIZE states of N vessels by all the moves at once, branch free. The levels are
+/// kept as structure of arrays, lane k of every array belongs to the k-th state, so a move is a few vector instructions
+/// for the whole batch, 8 lanes at a time with SSE2 and 16 with AVX2, AVX2 is picked at run time if the CPU has it.
+/// The narrower the levels the fewer registers a vector takes, 16 bit ones fill them exactly. The results of a move in
+/// the lanes where it is not possible are garbage, valid() masks them off. The goal test is done in the same pass, the
+/// new states are compared to the broadcast target.
+template <unsigned N, typename Water = water>
+class BasicSuccessorBatch {
+public:
+    using State = BasicVesselsState<N, Water>;
+
+    constexpr inline static const unsigned SIZE = 16;
+    constexpr inline static const int64_t NO_TARGET = -1;
+    constexpr inline static const unsigned NO_GOAL = SIZE * State::MOVES;
+
+    /// The order of BasicVesselsState::next_moves(), the successors of a state are taken in it
+    constexpr inline static const std::array<Move, State::MOVES> ORDER = [] {
+        std::array<Move, State::MOVES> order{};
+        unsigned pos = 0;
+        for (unsigned src = 0; src != N; ++src) {
+            order[pos++] = fill_move(src);
+            order[pos++] = drain_move<N>(src);
+            for (unsigned dst = 0; dst != N; ++dst) {
+                if (dst != src) {
+                    order[pos++] = pour_move<N>(src, dst);
+                }
+            }
+        }
+        return order;
+    }();
+
+    using Lanes = std::array<Water, SIZE>;
+    using Levels = std::array<Lanes, N>; // By vessel
+
+protected:
+    alignas(32) Levels m_levels{};
+    alignas(32) std::array<Levels, State::MOVES> m_next{}; // By move code
+    std::array<uint32_t, State::MOVES> m_valid{};          // Bit mask of the lanes a move is possible in
+    std::array<uint32_t, State::MOVES> m_goal{};           // Bit mask of the lanes a move gets the target in
+    unsigned m_size = 0;
+
+public:
+    void clear() noexcept {
+        m_size = 0;
+    }
+
+    void push_back(const State &state) noexcept {
+        assert(m_size < SIZE);
+        for (unsigned vessel = 0; vessel != N; ++vessel) {
+            m_levels[vessel][m_size] = state[vessel];
+        }
+        ++m_size;
+    }
+
+    [[nodiscard]]
+    unsigned size() const noexcept {
+        return m_size;
+    }
+
+    /// Compute the successors of all the states pushed since clear() and which of them hold the target
+    void expand(const State &volumes, int64_t target = NO_TARGET) noexcept {
+        m_goal.fill(0);
+#if defined(__x86_64__) || defined(__i386__)
+        static const bool avx2 = __builtin_cpu_supports("avx2") != 0;
+        if (avx2) {
+            expand_avx2(volumes, target);
+        } else {
+            kernel<8>(volumes, target); // SSE2, always there on x86-64
+        }
+#else
+        kernel<SIZE>(volumes, target);
+#endif
+        const uint32_t used = (uint32_t(1) << m_size) - 1;
+        for (unsigned code = 0; code != State::MOVES; ++code) {
+            m_valid[code] &= used;
+            m_goal[code] &= m_valid[code];
+        }
+    }
+
+    /// Is the move possible from the state in the lane?
+    [[nodiscard]]
+    bool valid(Move move, unsigned lane) const noexcept {
+        return ((m_valid[static_cast<unsigned>(move)] >> lane) & 1) != 0;
+    }
+
+    /// Does the move get the target from the state in the lane? Always false without a target.
+    [[nodiscard]]
+    bool goal(Move move, unsigned lane) const noexcept {
+        return ((m_goal[static_cast<unsigned>(move)] >> lane) & 1) != 0;
+    }
+
+    /// Position of the first successor holding the target, lane * State::MOVES + its index in ORDER, NO_GOAL if none.
+    /// No successor before it needs a goal test.
+    [[nodiscard]]
+    unsigned first_goal() const noexcept {
+        uint32_t lanes = 0;
+        for (const uint32_t goal : m_goal) {
+            lanes |= goal;
+        }
+        if (lanes == 0) {
+            return NO_GOAL;
+        }
+        const auto lane = static_cast<unsigned>(std::countr_zero(lanes));
+        unsigned order = 0;
+        while (!goal(ORDER[order], lane)) {
+            ++order;
+        }
+        return lane * State::MOVES + order;
+    }
+
+    /// The state the move leads to from the state in the lane
+    [[nodiscard]]
+    State state(Move move, unsigned lane) const noexcept {
+        const Levels &next = m_next[static_cast<unsigned>(move)];
+        State result;
+        unrolled<N>([&](unsigned vessel) { result[vessel] = next[vessel][lane]; });
+        return result;
+    }
+
+protected:
+#if defined(__x86_64__) || defined(__i386__)
+    [[gnu::target("avx2")]] void expand_avx2(const State &volumes, int64_t target) noexcept {
+        kernel<16>(volumes, target);
+    }
+#endif
+
+    /// Lane mask of a comparison result
+    template <unsigned WIDTH, typename Mask>
+    [[gnu::always_inline]] static inline uint32_t bits(const Mask &mask) noexcept {
+        uint32_t result = 0;
+        for (unsigned lane = 0; lane != WIDTH; ++lane) {
+            result |= uint32_t(mask[lane] & 1) << lane;
+        }
+        return result;
+    }
+
+    /// All the moves for WIDTH lanes at a time, inlined so it is compiled for the instruction set of the caller
+    template <unsigned WIDTH>
+    [[gnu::always_inline]] inline void kernel(const State &volumes, int64_t target) noexcept {
+        using Vector = typename LevelVectors<Water, WIDTH>::Type;
+        constexpr uint32_t LANES = (uint32_t(1) << WIDTH) - 1;
+        const Vector wanted = Vector{} + static_cast<Water>(target);
+
+        for (unsigned first = 0; first < m_size; first += WIDTH) {
+            Vector level[N]; // NOLINT(*-avoid-c-arrays)
+            Vector full[N];  // NOLINT(*-avoid-c-arrays)
+            Vector room[N];  // NOLINT(*-avoid-c-arrays)
+            for (unsigned vessel = 0; vessel != N; ++vessel) {
+                std::memcpy(&level[vessel], &m_levels[vessel][first], sizeof(Vector));
+                full[vessel] = Vector{} + volumes[vessel];
+                room[vessel] = full[vessel] - level[vessel];
+            }
+            const auto store = [&](Move move, const Vector *next, uint32_t valid) noexcept {
+                const auto code = static_cast<unsigned>(move);
+                for (unsigned vessel = 0; vessel != N; ++vessel) {
+                    std::memcpy(&m_next[code][vessel][first], &next[vessel], sizeof(Vector));
+                }
+                m_valid[code] = (m_valid[code] & ~(LANES << first)) | (valid << first);
+                if (target != NO_TARGET) {
+                    auto found = next[0] == wanted;
+                    for (unsigned vessel = 1; vessel != N; ++vessel) {
+                        found |= next[vessel] == wanted;
+                    }
+                    m_goal[code] |= bits<WIDTH>(found) << first;
+                }
+            };
+
+            for (unsigned src = 0; src != N; ++src) {
+                const uint32_t empty = bits<WIDTH>(level[src] == 0);
+                Vector next[N]; // NOLINT(*-avoid-c-arrays)
+                for (unsigned vessel = 0; vessel != N; ++vessel) {
+                    next[vessel] = level[vessel];
+                }
+                next[src] = full[src];
+                store(fill_move(src), next, empty); // Only an empty vessel is filled
+                next[src] = Vector{};
+                store(drain_move<N>(src), next, ~empty & LANES);
+                for (unsigned dst = 0; dst != N; ++dst) {
+                    if (dst == src) {
+                        continue;
+                    }
+                    // Nothing is poured unless the source has some and the destination has room
+                    const Vector poured = level[src] < room[dst] ? level[src] : room[dst];
+                    for (unsigned vessel = 0; vessel != N; ++vessel) {
+                        next[vessel] = level[vessel];
+                    }
+                    next[src] -= poured;
+                    next[dst] += poured;
+                    store(pour_move<N>(src, dst), next, bits<WIDTH>(poured != 0));
+                }
+            }
+        }
+    }
+};
+
+using SuccessorBatch = BasicSuccessorBatch<3>;
+
+static_assert([] { // ORDER is the order of next_moves()
+    const VesselsState volumes{3, 5, 8};
+    for (const VesselsState state : {VesselsState{0, 0, 0}, VesselsState{1, 5, 0}, VesselsState{3, 2, 4}}) {
+        size_t found = 0;
+        for (const Move move : SuccessorBatch::ORDER) {
+            const auto moves = state.next_moves(volumes);
+            found += found < moves.size() && moves[found].move == move ? 1 : 0;
+        }
+        if (found != state.next_moves(volumes).size()) {
+            return false;
+        }
+    }
+    return true;
+}());
+static_assert(BasicSuccessorBatch<3, uint8_t>::ORDER == SuccessorBatch::ORDER);
+static_assert([] { // Also with more vessels
+    const BasicVesselsState<4> volumes{3, 5, 8, 9};
+    const BasicVesselsState<4> state{0, 5, 2, 9};
+    size_t found = 0;
+    for (const Move move : BasicSuccessorBatch<4>::ORDER) {
+        const auto moves = state.next_moves(volumes);
+        found += found < moves.size() && moves[found].move == move ? 1 : 0;
+    }
+    return found == state.next_moves(volumes).size();
+}());
@@ -0,0 +1,112 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cassert>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+#include "utils.h"
+#include "vessels_state.h"
+
+/// Vessels of equal volume are interchangeable: swapping their levels in a state swaps them in all of its successors,
+/// so states that differ only by such swaps are the same number of steps away and hold the same amounts. A search needs
+/// just one of them, the canonical one with the levels of every group of equal volumes in ascending order.
+template <typename State = VesselsState>
+class Symmetry {
+    using Swap = std::pair<unsigned, unsigned>; // Order the levels of two vessels of equal volume
+
+    InlineVector<Swap, State::VESSELS * (State::VESSELS - 1) / 2> m_swaps{}; // Sorting network of every group
+
+public:
+    constexpr Symmetry() noexcept = default;
+
+    /// The groups of the vessels with equal volumes, the ones without volume are always empty and left out
+    constexpr explicit Symmetry(const State &volumes) noexcept {
+        constexpr unsigned N = State::VESSELS;
+        std::array<bool, N> grouped{};
+        for (unsigned first = 0; first != N; ++first) {
+            if (grouped[first] || volumes[first] == 0) {
+                continue;
+            }
+            InlineVector<unsigned, N> group;
+            for (unsigned vessel = first; vessel != N; ++vessel) {
+                if (volumes[vessel] == volumes[first]) {
+                    grouped[vessel] = true;
+                    group.push_back(vessel);
+                }
+            }
+            for (size_t pass = 1; pass < group.size(); ++pass) { // Bubble sort, the groups are small
+                for (size_t idx = 0; idx + pass != group.size(); ++idx) {
+                    m_swaps.push_back({group[idx], group[idx + 1]});
+                }
+            }
+        }
+    }
+
+    /// No vessels of equal volume, every state is canonical
+    [[nodiscard]]
+    constexpr bool empty() const noexcept {
+        return m_swaps.empty();
+    }
+
+    /// The representative of the states that differ from this one by swapping vessels of equal volume. Sorted in the
+    /// packed levels if they are an integer, writing the levels one by one stalls the next read of the whole state.
+    [[nodiscard]]
+    constexpr State canonical(State state) const noexcept {
+        if (m_swaps.empty()) {
+            return state;
+        }
+        using Packed = typename State::Packed;
+        if constexpr (requires(Packed packed) { packed >> 1; }) {
+            constexpr unsigned BITS = State::BITS;
+            constexpr Packed FIELD = (Packed(1) << BITS) - 1;
+            Packed packed = state.packed();
+            for (const auto &[low, high] : m_swaps) {
+                const Packed first = packed >> (low * BITS) & FIELD;
+                const Packed second = packed >> (high * BITS) & FIELD;
+                packed ^= (first ^ std::min(first, second)) << (low * BITS) |
+                          (second ^ std::max(first, second)) << (high * BITS);
+            }
+            return State::unpacked(packed);
+        } else {
+            for (const auto &[low, high] : m_swaps) {
+                const auto level = state[low];
+                state[low] = std::min(level, state[high]);
+                state[high] = std::max(level, state[high]);
+            }
+            return state;
+        }
+    }
+
+    /// The moves of a path of canonical states from the initial one, each one is a successor of the previous state
+    /// only up to the swaps: take the successor of the actual previous state with the same canonical state
+    [[nodiscard]]
+    std::vector<State> unfolded(const std::vector<State> &path, const State &volumes) const {
+        if (empty() || path.empty()) {
+            return path;
+        }
+        std::vector<State> states{path.front()};
+        states.reserve(path.size());
+        for (size_t step = 1; step != path.size(); ++step) {
+            const auto successors = states.back().next_states(volumes);
+            const auto *next = std::find_if(successors.begin(), successors.end(),
+                                            [&](const State &state) { return canonical(state) == path[step]; });
+            assert(next != successors.end());
+            states.push_back(*next);
+        }
+        return states;
+    }
+};
+
+static_assert(Symmetry<>().empty() && Symmetry<>(VesselsState{3, 5, 8}).empty());
+static_assert(Symmetry<>(VesselsState{0, 0, 8}).empty());
+static_assert(Symmetry<>(VesselsState{5, 3, 5}).canonical(VesselsState{4, 1, 2}) == VesselsState{2, 1, 4});
+static_assert(Symmetry<>(VesselsState{5, 3, 5}).canonical(VesselsState{2, 1, 4}) == VesselsState{2, 1, 4});
+static_assert(Symmetry<>(VesselsState{7, 7, 7}).canonical(VesselsState{6, 0, 3}) == VesselsState{0, 3, 6});
+static_assert(Symmetry<BasicVesselsState<5>>(BasicVesselsState<5>{4, 9, 4, 9, 4}).canonical(
+                  BasicVesselsState<5>{3, 8, 1, 2, 0}) == BasicVesselsState<5>{0, 2, 1, 8, 3});
+static_assert(Symmetry<BasicVesselsState<6, uint32_t>>(BasicVesselsState<6, uint32_t>{9, 9, 9, 9, 9, 9})
+                  .canonical(BasicVesselsState<6, uint32_t>{6, 5, 4, 3, 2, 1}) ==
+              BasicVesselsState<6, uint32_t>{1, 2, 3, 4, 5, 6});
@@ -0,0 +1,142 @@
+#pragma once
+
+#include <cassert>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/// Fixed set of worker threads running batches of independent tasks, identified by their index. Each worker gets a
+/// contiguous range of the task indices in its own queue and takes them from the back, an idle worker steals from the
+/// front of the others' queues, so a few slow tasks do not keep the rest of the workers waiting.
+class WorkStealingPool {
+public:
+    using Task = std::function<void(unsigned worker, size_t index)>;
+
+protected:
+    struct alignas(64) Queue { // A cache line each, the workers lock them all the time
+        std::mutex mutex{};
+        std::deque<size_t> tasks{};
+    };
+
+    std::vector<Queue> m_queues;
+    Task m_task{};
+    std::mutex m_mutex{}; // Guards the rest
+    std::condition_variable m_wake{};
+    std::condition_variable m_done{};
+    uint64_t m_generation = 0; // Count of batches started
+    size_t m_pending = 0;      // Tasks of the current batch not finished yet
+    bool m_stop = false;
+    std::vector<std::thread> m_threads{};
+
+public:
+    explicit WorkStealingPool(unsigned workers) : m_queues(std::max(workers, 1U)) {
+        m_threads.reserve(m_queues.size());
+        for (unsigned worker = 0; worker != m_queues.size(); ++worker) {
+            m_threads.emplace_back([this, worker] { work(worker); });
+        }
+    }
+
+    WorkStealingPool(const WorkStealingPool &) = delete;
+    WorkStealingPool &operator=(const WorkStealingPool &) = delete;
+    WorkStealingPool(WorkStealingPool &&) = delete;
+    WorkStealingPool &operator=(WorkStealingPool &&) = delete;
+
+    ~WorkStealingPool() {
+        {
+            const std::lock_guard lock(m_mutex);
+            m_stop = true;
+        }
+        m_wake.notify_all();
+        for (std::thread &thread : m_threads) {
+            thread.join();
+        }
+    }
+
+    [[nodiscard]]
+    unsigned workers() const noexcept {
+        return static_cast<unsigned>(m_queues.size());
+    }
+
+    /// Run task(worker, index) for every index in [0, count) and wait for all of them to finish. The task must not
+    /// throw, the worker is in [0, workers()) and only one task runs on a worker at a time.
+    void run(size_t count, Task task) {
+        if (count == 0) {
+            return;
+        }
+        m_task = std::move(task);
+        {
+            const std::lock_guard lock(m_mutex);
+            m_pending = count;
+        }
+        const size_t workers = m_queues.size();
+        for (size_t worker = 0; worker != workers; ++worker) {
+            const std::lock_guard lock(m_queues[worker].mutex);
+            for (size_t index = count * worker / workers; index != count * (worker + 1) / workers; ++index) {
+                m_queues[worker].tasks.push_back(index);
+            }
+        }
+        {
+            const std::lock_guard lock(m_mutex);
+            ++m_generation;
+        }
+        m_wake.notify_all();
+
+        std::unique_lock lock(m_mutex);
+        m_done.wait(lock, [this] { return m_pending == 0; });
+    }
+
+protected:
+    void work(unsigned worker) {
+        uint64_t generation = 0;
+        while (true) {
+            {
+                std::unique_lock lock(m_mutex);
+                m_wake.wait(lock, [&] { return m_stop || m_generation != generation; });
+                if (m_stop) {
+                    return;
+                }
+                generation = m_generation;
+            }
+
+            size_t finished = 0;
+            for (size_t index = 0; next(worker, index); ++finished) {
+                m_task(worker, index);
+            }
+
+            const std::lock_guard lock(m_mutex);
+            assert(m_pending >= finished);
+            m_pending -= finished;
+            if (m_pending == 0) {
+                m_done.notify_all();
+            }
+        }
+    }
+
+    /// Take a task from the back of the own queue or steal one from the front of another, false if all are empty
+    bool next(unsigned worker, size_t &index) {
+        {
+            Queue &own = m_queues[worker];
+            const std::lock_guard lock(own.mutex);
+            if (!own.tasks.empty()) {
+                index = own.tasks.back();
+                own.tasks.pop_back();
+                return true;
+            }
+        }
+        for (size_t offset = 1; offset != m_queues.size(); ++offset) {
+            Queue &other = m_queues[(worker + offset) % m_queues.size()];
+            const std::lock_guard lock(other.mutex);
+            if (!other.tasks.empty()) {
+                index = other.tasks.front();
+                other.tasks.pop_front();
+                return true;
+            }
+        }
+        return false;
+    }
+};
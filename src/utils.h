@@ -1,5 +1,12 @@
 #pragma once
 
+#include <array>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <utility>
+
 /// GCD - Greatest common divisor with two arguments
 template <typename T>
 constexpr T gcd(const T &lhs, const T &rhs) noexcept {
@@ -19,3 +26,130 @@ constexpr T gcd(const T &lhs, const T &rhs, Args... args) {
     return gcd(gcd(lhs, rhs), args...);
 }
 static_assert(gcd(1071, 462, 84) == 21, "Error at gcd(1071, 462, 84)");
+
+/// Extended Euclid result, lhs * x + rhs * y == gcd
+struct Bezout {
+    int64_t gcd;
+    int64_t x;
+    int64_t y;
+};
+
+/// Extended Euclid - the GCD and the Bezout coefficients
+constexpr Bezout extended_gcd(int64_t lhs, int64_t rhs) noexcept {
+    Bezout prev{lhs, 1, 0};
+    Bezout next{rhs, 0, 1};
+    while (next.gcd != 0) {
+        const int64_t quotient = prev.gcd / next.gcd;
+        const Bezout rest{prev.gcd - quotient * next.gcd, prev.x - quotient * next.x, prev.y - quotient * next.y};
+        prev = next;
+        next = rest;
+    }
+    return prev;
+}
+static_assert(extended_gcd(240, 46).gcd == 2 && 240 * extended_gcd(240, 46).x + 46 * extended_gcd(240, 46).y == 2);
+static_assert(extended_gcd(3, 5).x == 2 && extended_gcd(3, 5).y == -1, "3 * 2 - 5 == 1");
+static_assert(extended_gcd(7, 0).gcd == 7 && extended_gcd(7, 0).x == 1);
+
+/// The x in [0, modulus) with value * x == 1 (mod modulus), value and modulus must be coprime
+constexpr int64_t mod_inverse(int64_t value, int64_t modulus) noexcept {
+    const Bezout bezout = extended_gcd(value % modulus, modulus);
+    assert(bezout.gcd == 1);
+    return (bezout.x % modulus + modulus) % modulus;
+}
+static_assert(mod_inverse(3, 5) == 2 && mod_inverse(5, 3) == 2 && mod_inverse(1, 1) == 0);
+static_assert(mod_inverse(1071 / 21, 462 / 21) * (1071 / 21) % (462 / 21) == 1);
+
+/// a * b, the uint64_t max if it does not fit
+constexpr uint64_t mul_sat(uint64_t lhs, uint64_t rhs) noexcept {
+    uint64_t result = 0;
+    return __builtin_mul_overflow(lhs, rhs, &result) ? std::numeric_limits<uint64_t>::max() : result;
+}
+
+/// a + b, the uint64_t max if it does not fit
+constexpr uint64_t add_sat(uint64_t lhs, uint64_t rhs) noexcept {
+    uint64_t result = 0;
+    return __builtin_add_overflow(lhs, rhs, &result) ? std::numeric_limits<uint64_t>::max() : result;
+}
+static_assert(mul_sat(uint64_t(1) << 32, uint64_t(1) << 32) == std::numeric_limits<uint64_t>::max());
+static_assert(add_sat(std::numeric_limits<uint64_t>::max(), 1) == std::numeric_limits<uint64_t>::max());
+static_assert(mul_sat(6, 7) == 42 && add_sat(6, 7) == 13);
+
+/// The sizes mul_sat() and add_sat() saturate to, too big for anything
+constexpr uint64_t SATURATED = std::numeric_limits<uint64_t>::max();
+
+/// value / divisor rounded up, without the overflow of (value + divisor - 1) / divisor
+constexpr uint64_t div_ceil(uint64_t value, uint64_t divisor) noexcept {
+    return value / divisor + (value % divisor != 0 ? 1 : 0);
+}
+static_assert(div_ceil(64, 64) == 1 && div_ceil(65, 64) == 2 && div_ceil(0, 32) == 0);
+static_assert(div_ceil(SATURATED, 64) == uint64_t(1) << 58);
+
+/// Call `func(index)` for every index in [0, N), unrolled at compile time
+template <unsigned N, typename Func>
+[[gnu::always_inline]] constexpr void unrolled(Func &&func) {
+    [&func]<unsigned... INDEX>(std::integer_sequence<unsigned, INDEX...>) {
+        (func(INDEX), ...);
+    }(std::make_integer_sequence<unsigned, N>{});
+}
+
+/// Is `pred(index)` true for any index in [0, N)? Unrolled at compile time, stops at the first true.
+template <unsigned N, typename Pred>
+[[gnu::always_inline]] constexpr bool unrolled_any(Pred &&pred) {
+    return [&pred]<unsigned... INDEX>(std::integer_sequence<unsigned, INDEX...>) {
+        return (pred(INDEX) || ...);
+    }(std::make_integer_sequence<unsigned, N>{});
+}
+
+/// Vector with a fixed capacity kept inline, push_back() never touches the heap
+template <typename T, size_t N>
+class InlineVector {
+    std::array<T, N> m_items{};
+    size_t m_size = 0;
+
+public:
+    constexpr void push_back(const T &item) noexcept {
+        assert(m_size < N);
+        m_items[m_size++] = item;
+    }
+
+    /// Store the item past the end and keep it if `keep`, no branch. Needs a free slot even if it is not kept.
+    constexpr void push_back_if(const T &item, bool keep) noexcept {
+        assert(m_size < N);
+        m_items[m_size] = item;
+        m_size += keep ? 1 : 0;
+    }
+
+    constexpr void clear() noexcept {
+        m_size = 0;
+    }
+
+    [[nodiscard]]
+    constexpr size_t size() const noexcept {
+        return m_size;
+    }
+
+    [[nodiscard]]
+    constexpr bool empty() const noexcept {
+        return m_size == 0;
+    }
+
+    [[nodiscard]]
+    static constexpr size_t capacity() noexcept {
+        return N;
+    }
+
+    constexpr const T &operator[](size_t pos) const noexcept {
+        assert(pos < m_size);
+        return m_items[pos];
+    }
+
+    [[nodiscard]]
+    constexpr const T *begin() const noexcept {
+        return m_items.data();
+    }
+
+    [[nodiscard]]
+    constexpr const T *end() const noexcept {
+        return m_items.data() + m_size;
+    }
+};
@@ -0,0 +1,586 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <type_traits>
+
+#include "utils.h"
+
+using water = uint16_t; // Water level measurement
+
+template <typename T>
+constexpr T type_max() noexcept {
+    return std::numeric_limits<T>::max();
+}
+
+/// 128 bit unsigned integer, for the packed states of more than 3 vessels
+__extension__ typedef unsigned __int128 uint128; // NOLINT(modernize-use-using), a GCC and Clang extension
+
+/// The 12 possible moves of three vessels, 3 fills, 3 drains and 6 transfers, a move code fits in 4 bits.
+/// With N vessels the codes are laid out the same way, N fills, N drains and N * (N - 1) transfers, only the three
+/// vessel ones have names.
+enum class Move : uint8_t {
+    fill_0, fill_1, fill_2,
+    drain_0, drain_1, drain_2,
+    pour_0_1, pour_0_2, pour_1_0, pour_1_2, pour_2_0, pour_2_1,
+};
+
+/// Number of moves with `vessels` vessels, a fill and a drain of each and a transfer to each other one
+constexpr unsigned moves_count(unsigned vessels) noexcept {
+    return vessels * (vessels + 1);
+}
+
+constexpr inline const unsigned MOVES_COUNT = moves_count(3);
+
+constexpr Move fill_move(unsigned vessel) noexcept {
+    return static_cast<Move>(vessel);
+}
+
+template <unsigned N = 3>
+constexpr Move drain_move(unsigned vessel) noexcept {
+    return static_cast<Move>(N + vessel);
+}
+
+template <unsigned N = 3>
+constexpr Move pour_move(unsigned src, unsigned dst) noexcept {
+    return static_cast<Move>(2 * N + src * (N - 1) + (dst > src ? dst - 1 : dst));
+}
+
+static_assert(pour_move(0, 1) == Move::pour_0_1 && pour_move(1, 2) == Move::pour_1_2);
+static_assert(pour_move(2, 0) == Move::pour_2_0 && pour_move(2, 1) == Move::pour_2_1);
+static_assert(drain_move<4>(3) == static_cast<Move>(7) && pour_move<4>(3, 2) == static_cast<Move>(moves_count(4) - 1));
+
+/// Levels of BITS bits in all packed with a spare top bit: an integer if they fit in 64 or 128 bits, 64 bit words
+/// otherwise. The integers keep the state in registers, an array of a single word does not.
+template <unsigned BITS>
+using PackedLevels = std::conditional_t<(BITS < 64), uint64_t,
+                                        std::conditional_t<(BITS < 128), uint128, std::array<uint64_t, BITS / 64 + 1>>>;
+
+/// 64 bits of a packed state for the hashes, the exact pack if it fits
+constexpr uint64_t fold(uint64_t packed) noexcept {
+    return packed;
+}
+
+/// 64 bits of a packed state for the hashes, the high half multiplied by an odd constant into the low one
+constexpr uint64_t fold(uint128 packed) noexcept {
+    return static_cast<uint64_t>(packed) ^ static_cast<uint64_t>(packed >> 64) * 0xC2B2AE3D27D4EB4FULL;
+}
+
+/// 64 bits of a packed state for the hashes, the words multiplied in by the odd constant one by one
+template <size_t WORDS>
+constexpr uint64_t fold(const std::array<uint64_t, WORDS> &packed) noexcept {
+    uint64_t result = packed[WORDS - 1];
+    for (size_t word = WORDS - 1; word-- != 0;) {
+        result = result * 0xC2B2AE3D27D4EB4FULL ^ packed[word];
+    }
+    return result;
+}
+
+/// A state reached by a move
+template <typename State>
+struct StateTransition {
+    State state;
+    Move move;
+};
+
+/// N water vessel's current contents in liters of water, the volumes must be kept in one more State variable.
+/// The vessel count and the Water level type are compile time constants, the loops over the vessels are unrolled.
+/// Water is an unsigned integer of 8, 16 or 32 bits, the narrowest one the volumes fit in keeps the states small.
+// Inherits comparison operators from std::array<T, S>()
+template <unsigned N, typename Water = water>
+class BasicVesselsState: public std::array<Water, N> {
+    static_assert(N >= 1, "At least one vessel");
+    static_assert(std::is_unsigned_v<Water> && std::numeric_limits<Water>::digits <= 32 &&
+                      64 % std::numeric_limits<Water>::digits == 0,
+                  "8, 16 or 32 bit levels, the ranks and the pour and refill step counts are 64 bit products of them");
+
+    using Base = std::array<Water, N>;
+
+public:
+    /// Sizes of the sub boxes of the last vessels, [k] is of the vessels from k on, [N] is a single state. What
+    /// surface_rank() and surface_unrank() need, see surface_sizes().
+    struct SurfaceSizes {
+        std::array<uint64_t, N + 1> box;     // All the states
+        std::array<uint64_t, N + 1> surface; // The ones with a vessel empty or full
+    };
+
+    using Transition = StateTransition<BasicVesselsState>;
+    using Level = Water;
+
+    constexpr inline static const unsigned BITS = std::numeric_limits<Water>::digits; // Per level
+
+    /// The levels packed BITS each, with a spare top bit for the empty slot of a set, see PackedLevels
+    using Packed = PackedLevels<N * BITS>;
+
+    /// Not the packed() of any state, all the bits set
+    constexpr inline static const Packed NOT_PACKED = [] {
+        if constexpr (N * BITS < 128) {
+            return ~Packed(0);
+        } else {
+            Packed packed{};
+            packed.fill(~uint64_t(0));
+            return packed;
+        }
+    }();
+
+    constexpr inline static const unsigned VESSELS = N;
+    constexpr inline static const unsigned MOVES = moves_count(N);
+
+    /// Each vessel is either filled or drained, plus N * (N - 1) transfers
+    using NextStates = InlineVector<BasicVesselsState, N * N>;
+    using NextMoves = InlineVector<Transition, N * N>;
+
+    constexpr BasicVesselsState() noexcept: Base{} {}
+
+    template <typename... Levels>
+        requires(sizeof...(Levels) == N && (std::is_convertible_v<Levels, Water> && ...))
+    constexpr BasicVesselsState(Levels... levels) noexcept: Base{static_cast<Water>(levels)...} {}
+
+    /// Hash for unordered containers, the exact packed() if it fits in 64 bits, see hash.h for the mixing ones.
+    /// C++ 23 it can even be static (__cpp_static_call_operator, P1169R3)
+    constexpr size_t operator()(const BasicVesselsState &state) const noexcept {
+        return fold(state.packed());
+    };
+
+    /// The levels in the low N * BITS bits, the first vessel lowest, a level never straddles two words
+    [[nodiscard]]
+    constexpr Packed packed() const noexcept {
+        Packed result{};
+        unrolled<N>([&](unsigned vessel) {
+            if constexpr (N * BITS < 128) {
+                result |= Packed((*this)[vessel]) << (vessel * BITS);
+            } else {
+                result[vessel * BITS / 64] |= uint64_t((*this)[vessel]) << (vessel * BITS % 64);
+            }
+        });
+        return result;
+    }
+
+    /// Inverse of packed()
+    [[nodiscard]]
+    static constexpr BasicVesselsState unpacked(const Packed &packed) noexcept {
+        BasicVesselsState state;
+        unrolled<N>([&](unsigned vessel) {
+            if constexpr (N * BITS < 128) {
+                state[vessel] = static_cast<Water>(packed >> (vessel * BITS));
+            } else {
+                state[vessel] = static_cast<Water>(packed[vessel * BITS / 64] >> (vessel * BITS % 64));
+            }
+        });
+        return state;
+    }
+
+    /// Number of distinct states in the (V0+1)*(V1+1)*... box, `this` being the volumes, the uint64_t max if more
+    [[nodiscard]]
+    constexpr uint64_t box_size() const noexcept {
+        uint64_t size = 1;
+        unrolled<N>([&](unsigned vessel) { size = mul_sat(size, (*this)[vessel] + uint64_t(1)); });
+        return size;
+    }
+
+    /// Mixed-radix state id in [0, volumes.box_size()), the last vessel is the fastest changing digit
+    [[nodiscard]]
+    constexpr uint64_t box_id(const BasicVesselsState &volumes) const noexcept {
+        return box_id(volumes, 0);
+    }
+
+    /// Number of states on the surface of the box, the ones with at least one vessel empty or full, `this` being the
+    /// volumes, the uint64_t max if more. Starting empty and only filling, draining or pouring never leaves the
+    /// surface.
+    [[nodiscard]]
+    constexpr uint64_t surface_size() const noexcept {
+        return surface_sizes(*this).surface[0];
+    }
+
+    /// Are we on the surface of the volumes box?
+    [[nodiscard]]
+    constexpr bool on_surface(const BasicVesselsState &volumes) const noexcept {
+        return unrolled_any<N>(
+            [&](unsigned vessel) { return (*this)[vessel] == 0 || (*this)[vessel] == volumes[vessel]; });
+    }
+
+    /// Dense id in [0, volumes.surface_size()) of a state on the surface. The first vessel empty and full slices are
+    /// whole boxes of the other vessels, the slices in between are only the surfaces of those boxes, recursively.
+    [[nodiscard]]
+    constexpr uint64_t surface_rank(const BasicVesselsState &volumes) const noexcept {
+        return surface_rank(volumes, surface_sizes(volumes));
+    }
+
+    /// surface_rank() with the sizes of the volumes computed once
+    [[nodiscard]]
+    constexpr uint64_t surface_rank(const BasicVesselsState &volumes, const SurfaceSizes &sizes) const noexcept {
+        uint64_t rank = 0;
+        for (unsigned vessel = 0; vessel != N; ++vessel) {
+            const Water level = (*this)[vessel];
+            if (level == 0) {
+                return rank + box_id(volumes, vessel + 1);
+            }
+            if (level == volumes[vessel]) {
+                return rank + sizes.box[vessel + 1] + inner(level) * sizes.surface[vessel + 1] +
+                       box_id(volumes, vessel + 1);
+            }
+            rank += sizes.box[vessel + 1] + (level - uint64_t(1)) * sizes.surface[vessel + 1];
+        }
+        assert(false); // Not on the surface
+        return rank;
+    }
+
+    /// Inverse of surface_rank()
+    [[nodiscard]]
+    static constexpr BasicVesselsState surface_unrank(uint64_t rank, const BasicVesselsState &volumes) noexcept {
+        return surface_unrank(rank, volumes, surface_sizes(volumes));
+    }
+
+    /// surface_unrank() with the sizes of the volumes computed once
+    [[nodiscard]]
+    static constexpr BasicVesselsState surface_unrank(uint64_t rank, const BasicVesselsState &volumes,
+                                                      const SurfaceSizes &sizes) noexcept {
+        BasicVesselsState state;
+        for (unsigned vessel = 0; vessel != N; ++vessel) {
+            if (rank < sizes.box[vessel + 1]) { // Empty
+                state.box_unrank(rank, volumes, vessel + 1);
+                return state;
+            }
+            rank -= sizes.box[vessel + 1];
+            const uint64_t between = inner(volumes[vessel]) * sizes.surface[vessel + 1];
+            if (rank >= between) { // Full
+                state[vessel] = volumes[vessel];
+                state.box_unrank(rank - between, volumes, vessel + 1);
+                return state;
+            }
+            state[vessel] = static_cast<Water>(1 + rank / sizes.surface[vessel + 1]);
+            rank %= sizes.surface[vessel + 1];
+        }
+        assert(false); // Out of range
+        return state;
+    }
+
+    /// The box and surface sizes of the last vessels, the uint64_t max if more. A state is on the surface of a box if
+    /// its first vessel is empty or full or the rest is on the surface of the smaller box.
+    [[nodiscard]]
+    static constexpr SurfaceSizes surface_sizes(const BasicVesselsState &volumes) noexcept {
+        SurfaceSizes sizes{};
+        sizes.box[N] = 1;
+        sizes.surface[N] = 0;
+        for (unsigned vessel = N; vessel-- != 0;) {
+            const Water volume = volumes[vessel];
+            sizes.box[vessel] = mul_sat(sizes.box[vessel + 1], volume + uint64_t(1));
+            sizes.surface[vessel] = volume == 0 ? sizes.box[vessel + 1]
+                                                : add_sat(mul_sat(2, sizes.box[vessel + 1]),
+                                                          mul_sat(inner(volume), sizes.surface[vessel + 1]));
+        }
+        return sizes;
+    }
+
+    /// Return new state after transferring water
+    [[nodiscard]]
+    constexpr BasicVesselsState transfer(unsigned src, unsigned dst, const BasicVesselsState &volumes) const noexcept {
+        BasicVesselsState result = *this; // copy
+        const auto dst_free = static_cast<Water>(volumes[dst] - (*this)[dst]);
+        if ((*this)[src] <= dst_free) {
+            result[dst] += (*this)[src];
+            result[src] = 0;
+        } else {
+            result[dst] += dst_free;
+            result[src] -= dst_free;
+        }
+        return result;
+    }
+
+    /// Calculate all possible next states, in place, no memory allocations
+    [[nodiscard]]
+    constexpr NextStates next_states(const BasicVesselsState &volumes) const noexcept {
+        NextStates result;
+        generate(volumes, [&result](Move /*move*/, const BasicVesselsState &state) { result.push_back(state); });
+        return result;
+    }
+
+    /// Calculate all possible next states and the moves leading to them, same order as next_states()
+    [[nodiscard]]
+    constexpr NextMoves next_moves(const BasicVesselsState &volumes) const noexcept {
+        NextMoves result;
+        generate(volumes, [&result](Move move, const BasicVesselsState &state) { result.push_back({state, move}); });
+        return result;
+    }
+
+    /// Reverse move generator, call `visit(state)` for every state `move` takes to `*this`.
+    /// A drain or transfer can come from many states, so there is no fixed bound.
+    template <typename Visitor>
+    constexpr void for_each_prev(Move move, const BasicVesselsState &volumes, Visitor &&visit) const {
+        const auto code = static_cast<unsigned>(move);
+        if (code < N) { // Fill, only empty vessels are filled
+            if ((*this)[code] == volumes[code] && volumes[code] != 0) {
+                BasicVesselsState prev = *this;
+                prev[code] = 0;
+                visit(prev);
+            }
+        } else if (code < 2 * N) { // Drain, from any level
+            const unsigned vessel = code - N;
+            if ((*this)[vessel] == 0) {
+                BasicVesselsState prev = *this;
+                for (uint64_t level = 1; level <= volumes[vessel]; ++level) {
+                    prev[vessel] = static_cast<Water>(level);
+                    visit(prev);
+                }
+            }
+        } else { // Transfer
+            const unsigned src = (code - 2 * N) / (N - 1);
+            const unsigned rest = (code - 2 * N) % (N - 1);
+            const unsigned dst = rest < src ? rest : rest + 1;
+            BasicVesselsState prev = *this;
+            if ((*this)[src] == 0) { // All of src fit in dst
+                const Water total = (*this)[dst];
+                for (uint64_t poured = 1; poured <= std::min(volumes[src], total); ++poured) {
+                    prev[src] = static_cast<Water>(poured);
+                    prev[dst] = static_cast<Water>(total - poured);
+                    visit(prev);
+                }
+            } else if ((*this)[dst] == volumes[dst]) { // dst got full, the rest stayed in src
+                const int64_t lowest = int64_t((*this)[src]) + volumes[dst] - volumes[src];
+                for (int64_t level = std::max<int64_t>(lowest, 0); level < volumes[dst]; ++level) {
+                    prev[dst] = static_cast<Water>(level);
+                    prev[src] = static_cast<Water>((*this)[src] + volumes[dst] - level);
+                    visit(prev);
+                }
+            }
+        }
+    }
+
+    // Do we contain the specified volume of water in any vessel?
+    [[nodiscard]]
+    constexpr bool contains(Water volume) const noexcept {
+        return unrolled_any<N>([&](unsigned vessel) { return (*this)[vessel] == volume; });
+    }
+
+    /// Every level multiplied by the factor
+    [[nodiscard]]
+    constexpr BasicVesselsState scaled(Water factor) const noexcept {
+        BasicVesselsState result;
+        unrolled<N>([&](unsigned vessel) { result[vessel] = static_cast<Water>((*this)[vessel] * factor); });
+        return result;
+    }
+
+    /// Every level divided by the divisor, it must divide all of them
+    [[nodiscard]]
+    constexpr BasicVesselsState divided(Water divisor) const noexcept {
+        BasicVesselsState result;
+        unrolled<N>([&](unsigned vessel) {
+            assert((*this)[vessel] % divisor == 0);
+            result[vessel] = static_cast<Water>((*this)[vessel] / divisor);
+        });
+        return result;
+    }
+
+private:
+    /// Generate all possible next states, calls `emit(move, state)` for each
+    template <typename Emit>
+    constexpr void generate(const BasicVesselsState &volumes, Emit &&emit) const {
+        unrolled<N>([&](unsigned from) {
+            // Fill (up to N)
+            if ((*this)[from] == 0) {
+                BasicVesselsState new_state = *this;
+                new_state[from] = volumes[from];
+                emit(fill_move(from), new_state);
+            }
+
+            // Drain (up to N)
+            if ((*this)[from] != 0) {
+                BasicVesselsState new_state = *this;
+                new_state[from] = 0;
+                emit(drain_move<N>(from), new_state);
+            }
+
+            // Transfer (up to N * (N - 1))
+            for (unsigned to = 0; to != N; ++to) {
+                if (from != to && (*this)[to] < volumes[to] && (*this)[from] > 0) {
+                    emit(pour_move<N>(from, to), transfer(from, to, volumes));
+                }
+            }
+        });
+    }
+
+    /// Mixed-radix id of the levels of the vessels from `first` on in their box
+    [[nodiscard]]
+    constexpr uint64_t box_id(const BasicVesselsState &volumes, unsigned first) const noexcept {
+        uint64_t result = 0;
+        for (unsigned vessel = first; vessel != N; ++vessel) {
+            result = result * (volumes[vessel] + uint64_t(1)) + (*this)[vessel];
+        }
+        return result;
+    }
+
+    /// Set the levels of the vessels from `first` on to the ones with the box id
+    constexpr void box_unrank(uint64_t id, const BasicVesselsState &volumes, unsigned first) noexcept {
+        for (unsigned vessel = N; vessel-- != first;) {
+            (*this)[vessel] = static_cast<Water>(id % (volumes[vessel] + uint64_t(1)));
+            id /= volumes[vessel] + uint64_t(1);
+        }
+    }
+
+    /// Number of levels strictly between empty and full
+    static constexpr uint64_t inner(Water volume) noexcept {
+        return volume > 0 ? volume - uint64_t(1) : 0;
+    }
+};
+
+/// The classic three vessels
+using VesselsState = BasicVesselsState<3>;
+
+// "Unit test" for C++20 and above
+#if __cplusplus >= 202002L
+/// Steps of the shortest solution of every amount below 16 by a plain breadth first search of the box, -1 if there is
+/// none. The rules of the solver, the empty and the full state are never entered. The reference of the "unit tests" of
+/// the oracle and the analytic solutions, for volumes with at most 1024 states in the box.
+template <unsigned N>
+constexpr std::array<int, 16> reference_steps(const BasicVesselsState<N> &volumes) {
+    std::array<int, 16> steps{};
+    std::array<int, 1024> depths{};
+    std::array<BasicVesselsState<N>, 1024> queue{};
+    steps.fill(-1);
+    depths.fill(-1);
+    depths[volumes.box_id(volumes)] = 0;
+    depths[0] = 0;
+    steps[0] = 0;
+    size_t size = 1;
+    for (size_t head = 0; head != size; ++head) {
+        const int depth = depths[queue[head].box_id(volumes)];
+        for (const BasicVesselsState<N> &next : queue[head].next_states(volumes)) {
+            int &seen = depths[next.box_id(volumes)];
+            if (seen >= 0) {
+                continue;
+            }
+            seen = depth + 1;
+            queue[size++] = next;
+            for (const auto level : next) {
+                if (level < steps.size() && steps[level] < 0) {
+                    steps[level] = depth + 1;
+                }
+            }
+        }
+    }
+    return steps;
+}
+
+static_assert(reference_steps(VesselsState{3, 5, 8})[4] == 6 && reference_steps(VesselsState{3, 5, 8})[9] == -1);
+static_assert(VesselsState{1, 2, 3} == VesselsState{1, 2, 3});
+static_assert(VesselsState{1, 2, 3} != VesselsState{2, 2, 3});
+static_assert(VesselsState{2, 2, 3} != VesselsState{1, 2, 3});
+static_assert(VesselsState{1, 2, 8} != VesselsState{1, 2, 3});
+static_assert(VesselsState{1, 2, 3} != VesselsState{1, 2, 8});
+static_assert(VesselsState{1, 2, 3} < VesselsState{1, 2, 4});
+static_assert(VesselsState{2, 2, 3} > VesselsState{1, 2, 4});
+static_assert(VesselsState{3, 5, 8}.scaled(100) == VesselsState{300, 500, 800});
+static_assert(VesselsState{300, 500, 800}.divided(100) == VesselsState{3, 5, 8});
+static_assert(VesselsState{3, 5, 8}.box_size() == 4 * 6 * 9);
+static_assert(VesselsState{1, 2, 3}.packed() == 0x0003'0002'0001);
+static_assert(VesselsState::unpacked(VesselsState{65535, 2, 3}.packed()) == VesselsState{65535, 2, 3});
+static_assert(type_max<water>() == 65535 && type_max<uint8_t>() == 255);
+static_assert(VesselsState{0, 0, 0}.box_id(VesselsState{3, 5, 8}) == 0);
+static_assert(VesselsState{0, 0, 1}.box_id(VesselsState{3, 5, 8}) == 1);
+static_assert(VesselsState{0, 1, 0}.box_id(VesselsState{3, 5, 8}) == 9);
+static_assert(VesselsState{1, 0, 0}.box_id(VesselsState{3, 5, 8}) == 54);
+static_assert(VesselsState{3, 5, 8}.box_id(VesselsState{3, 5, 8}) == 4 * 6 * 9 - 1);
+static_assert(VesselsState{3, 5, 8}.surface_size() == 4 * 6 * 9 - 2 * 4 * 7);
+static_assert(VesselsState{0, 5, 8}.surface_size() == 6 * 9);
+static_assert(VesselsState{1, 1, 1}.surface_size() == 8);
+static_assert(VesselsState{0, 0, 0}.surface_rank(VesselsState{3, 5, 8}) == 0);
+static_assert(VesselsState{1, 0, 0}.surface_rank(VesselsState{3, 5, 8}) == 6 * 9);
+static_assert(VesselsState{1, 2, 8}.surface_rank(VesselsState{3, 5, 8}) == 6 * 9 + 9 + 3);
+static_assert(VesselsState{3, 5, 8}.surface_rank(VesselsState{3, 5, 8}) == 4 * 6 * 9 - 2 * 4 * 7 - 1);
+static_assert(VesselsState::surface_unrank(6 * 9 + 9 + 3, VesselsState{3, 5, 8}) == VesselsState{1, 2, 8});
+static_assert(VesselsState::surface_unrank(6 * 9 + 26 + 5, VesselsState{3, 5, 8}) == VesselsState{2, 0, 5});
+static_assert(VesselsState::surface_unrank(6 * 9 + 26 + 9 + 8 + 4, VesselsState{3, 5, 8}) == VesselsState{2, 5, 4});
+static_assert([] { // for_each_prev() is the exact inverse of next_moves()
+    const VesselsState volumes{3, 5, 8};
+    for (water a = 0; a <= volumes[0]; ++a) {
+        for (water b = 0; b <= volumes[1]; ++b) {
+            for (water c = 0; c <= volumes[2]; ++c) {
+                const VesselsState state{a, b, c};
+                for (const VesselsState::Transition &next : state.next_moves(volumes)) {
+                    bool found = false;
+                    bool inverse = true;
+                    next.state.for_each_prev(next.move, volumes, [&](const VesselsState &prev) {
+                        found = found || prev == state;
+                        bool forward = false;
+                        for (const VesselsState::Transition &again : prev.next_moves(volumes)) {
+                            forward = forward || (again.move == next.move && again.state == next.state);
+                        }
+                        inverse = inverse && forward;
+                    });
+                    if (!found || !inverse) {
+                        return false;
+                    }
+                }
+            }
+        }
+    }
+    return true;
+}());
+static_assert([] { // The surface states in box order get consecutive ranks
+    for (const VesselsState volumes : {VesselsState{3, 5, 8}, VesselsState{0, 1, 2}, VesselsState{2, 0, 3}}) {
+        uint64_t rank = 0;
+        for (water a = 0; a <= volumes[0]; ++a) {
+            for (water b = 0; b <= volumes[1]; ++b) {
+                for (water c = 0; c <= volumes[2]; ++c) {
+                    const VesselsState state{a, b, c};
+                    if (!state.on_surface(volumes)) {
+                        continue;
+                    }
+                    if (state.surface_rank(volumes) != rank || VesselsState::surface_unrank(rank, volumes) != state) {
+                        return false;
+                    }
+                    ++rank;
+                }
+            }
+        }
+        if (rank != volumes.surface_size()) {
+            return false;
+        }
+    }
+    return true;
+}());
+static_assert(BasicVesselsState<2>{3, 5}.surface_size() == 4 * 6 - 2 * 4);
+static_assert(BasicVesselsState<4>{2, 3, 4, 5}.surface_size() == 3 * 4 * 5 * 6 - 1 * 2 * 3 * 4);
+static_assert(BasicVesselsState<6>{65535, 65535, 65535, 65535, 65535, 65535}.box_size() == type_max<uint64_t>());
+static_assert(BasicVesselsState<4>::unpacked(BasicVesselsState<4>{65535, 1, 2, 65535}.packed()) ==
+              BasicVesselsState<4>{65535, 1, 2, 65535});
+static_assert(BasicVesselsState<4>{1, 2, 3, 4}.next_states(BasicVesselsState<4>{5, 5, 5, 5}).size() == 4 * 4);
+static_assert([] { // The 4 vessel surface states in box order get consecutive ranks, the moves have inverses
+    const BasicVesselsState<4> volumes{1, 2, 0, 3};
+    uint64_t rank = 0;
+    for (uint64_t id = 0; id != volumes.box_size(); ++id) {
+        const BasicVesselsState<4> state{id / 12, id / 4 % 3, 0, id % 4};
+        if (state.box_id(volumes) != id) {
+            return false;
+        }
+        if (state.on_surface(volumes)) {
+            if (state.surface_rank(volumes) != rank || BasicVesselsState<4>::surface_unrank(rank, volumes) != state) {
+                return false;
+            }
+            ++rank;
+        }
+        for (const BasicVesselsState<4>::Transition &next : state.next_moves(volumes)) {
+            bool found = next.state == state; // Filling a vessel without volume changes nothing
+            next.state.for_each_prev(next.move, volumes, [&](const BasicVesselsState<4> &prev) {
+                found = found || prev == state;
+            });
+            if (!found) {
+                return false;
+            }
+        }
+    }
+    return rank == volumes.surface_size();
+}());
+static_assert(sizeof(BasicVesselsState<3, uint8_t>) == 3 && sizeof(BasicVesselsState<3, uint32_t>) == 12);
+static_assert(BasicVesselsState<3, uint8_t>{1, 2, 3}.packed() == 0x03'02'01);
+static_assert(sizeof(BasicVesselsState<4>::Packed) == 16 && sizeof(BasicVesselsState<4, uint32_t>::Packed) == 24);
+static_assert(BasicVesselsState<3, uint32_t>::unpacked(BasicVesselsState<3, uint32_t>{4294967295, 2, 3}.packed()) ==
+              BasicVesselsState<3, uint32_t>{4294967295, 2, 3});
+static_assert(BasicVesselsState<2, uint32_t>{4294967295, 0}.transfer(0, 1, {4294967295, 65536}) ==
+              BasicVesselsState<2, uint32_t>{4294901759, 65536});
+static_assert(BasicVesselsState<2, uint8_t>{255, 0}.next_states({255, 254}).size() == 3);
+#endif
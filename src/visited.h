@@ -0,0 +1,153 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cassert>
+#include <cstdint>
+#include <stdexcept>
+#include <vector>
+
+#include "flat_set.h"
+#include "vessels_state.h"
+
+/// How states are mapped to storage
+enum class Layout {
+    automatic, // box if small, surface if it fits, sparse otherwise
+    box,       // Bitmap over the whole (V0+1)*(V1+1)*... box, indexed by BasicVesselsState::box_id()
+    surface,   // Bitmap over the box surface only, indexed by BasicVesselsState::surface_rank()
+    sparse,    // Flat hash set of the states
+};
+
+/// The set of states already seen by the search.
+/// A flat bitmap indexed by a dense state id when the id space fits in DENSE_LIMIT bits, a flat hash set with the Hash
+/// policy otherwise.
+template <typename State = VesselsState, typename Hash = MixHash>
+class Visited {
+    using Bitmap = std::vector<uint64_t>;
+    using HashSet = FlatStateSet<State, Hash>;
+
+public:
+    constexpr inline static const uint64_t DENSE_LIMIT = uint64_t(1) << 35; // 4 GiB of bitmap
+    constexpr inline static const uint64_t BOX_LIMIT = uint64_t(1) << 24;   // Cheaper ids for boxes up to 2 MiB
+    constexpr inline static const uint64_t RESERVE_LIMIT = uint64_t(1) << 22; // Hash set preallocation, 64 MiB
+
+protected:
+    State m_volumes{};
+    typename State::SurfaceSizes m_sizes{}; // Of m_volumes, for the surface ranks
+    Layout m_layout = Layout::sparse;
+    Bitmap m_bits{};    // Used if dense()
+    HashSet m_states{}; // Used if !dense()
+
+public:
+    /// Forget all states and size the storage once for the given vessel volumes
+    void reset(const State &volumes, Layout layout = Layout::automatic) {
+        m_volumes = volumes;
+        m_sizes = State::surface_sizes(volumes);
+        m_layout = resolve(volumes, layout);
+        if (dense()) {
+            if (capacity() > DENSE_LIMIT) { // resolve() never picks such a bitmap
+                throw std::length_error("Visited: the id space does not fit in a bitmap");
+            }
+            m_states = HashSet{}; // Release the memory
+            m_bits.assign(div_ceil(capacity(), 64), 0);
+        } else {
+            m_bits = Bitmap{};
+            m_states.clear();
+            m_states.reserve(std::min(volumes.surface_size(), RESERVE_LIMIT)); // All reachable ones are on the surface
+        }
+    }
+
+    /// Pick the layout to use for the volumes, never automatic. A bitmap asked for is used only if its id space fits in
+    /// DENSE_LIMIT bits, the sizes saturate instead of wrapping, sparse otherwise.
+    [[nodiscard]]
+    static constexpr Layout resolve(const State &volumes, Layout layout) noexcept {
+        if (layout == Layout::sparse) {
+            return layout;
+        }
+        if (layout == Layout::box || (layout == Layout::automatic && volumes.box_size() <= BOX_LIMIT)) {
+            return volumes.box_size() <= DENSE_LIMIT ? Layout::box : Layout::sparse;
+        }
+        return volumes.surface_size() <= DENSE_LIMIT ? Layout::surface : Layout::sparse;
+    }
+
+    [[nodiscard]]
+    Layout layout() const noexcept {
+        return m_layout;
+    }
+
+    /// Is a bitmap used?
+    [[nodiscard]]
+    bool dense() const noexcept {
+        return m_layout != Layout::sparse;
+    }
+
+    /// Upper bound of the number of distinct reachable states, the size of the dense id space
+    [[nodiscard]]
+    uint64_t capacity() const noexcept {
+        return m_layout == Layout::box ? m_volumes.box_size() : m_volumes.surface_size();
+    }
+
+    /// Dense id of a state, valid if dense()
+    [[nodiscard]]
+    uint64_t id(const State &state) const noexcept {
+        assert(m_layout == Layout::box || state.on_surface(m_volumes));
+        return m_layout == Layout::box ? state.box_id(m_volumes) : state.surface_rank(m_volumes, m_sizes);
+    }
+
+    /// Add the state, returns false if it was already there
+    bool insert(const State &state) {
+        if (dense()) {
+            const uint64_t state_id = id(state);
+            uint64_t &word = m_bits[state_id / 64];
+            const uint64_t mask = uint64_t(1) << (state_id % 64);
+            if ((word & mask) != 0) {
+                return false;
+            }
+            word |= mask;
+            return true;
+        }
+        return m_states.insert(state);
+    }
+
+    /// insert() that can be called from several threads at once, the state is claimed with an atomic or on its bitmap
+    /// word. Only if dense().
+    bool insert_atomic(const State &state) noexcept {
+        assert(dense());
+        const uint64_t state_id = id(state);
+        const std::atomic_ref<uint64_t> word(m_bits[state_id / 64]);
+        const uint64_t mask = uint64_t(1) << (state_id % 64);
+        if ((word.load(std::memory_order_relaxed) & mask) != 0) {
+            return false; // Most are seen already, skip the locked instruction
+        }
+        return (word.fetch_or(mask, std::memory_order_relaxed) & mask) == 0;
+    }
+
+    /// Start loading the memory insert() or contains() of the state will need, for a batch of them soon after
+    void prefetch(const State &state) const noexcept {
+        if (dense()) {
+            __builtin_prefetch(&m_bits[id(state) / 64]);
+        } else {
+            m_states.prefetch(state);
+        }
+    }
+
+    [[nodiscard]]
+    bool contains(const State &state) const {
+        if (m_layout == Layout::surface && !state.on_surface(m_volumes)) {
+            return false; // Never reachable
+        }
+        if (dense()) {
+            const uint64_t state_id = id(state);
+            return (m_bits[state_id / 64] & (uint64_t(1) << (state_id % 64))) != 0;
+        }
+        return m_states.contains(state);
+    }
+};
+
+static_assert(Visited<>::resolve(VesselsState{3, 5, 8}, Layout::automatic) == Layout::box);
+static_assert(Visited<>::resolve(VesselsState{3, 5, 8}, Layout::surface) == Layout::surface);
+static_assert(Visited<>::resolve(VesselsState{3, 5, 8}, Layout::sparse) == Layout::sparse);
+static_assert(Visited<BasicVesselsState<3, uint32_t>>::resolve({4000000000, 3999999999, 3999999997}, Layout::box) ==
+              Layout::sparse); // The box size saturates
+static_assert(Visited<BasicVesselsState<6, uint32_t>>::resolve({60000, 60001, 60003, 60005, 60007, 60009},
+                                                               Layout::surface) == Layout::sparse);
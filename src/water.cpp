@@ -1,249 +1,493 @@
 #include <algorithm>
 #include <array>
 #include <cassert>
-#include <cstdint>
+#include <cctype>
+#include <cstdlib>
+#include <cstring>
 #include <fmt/core.h>
-#include <limits>
+#include <fstream>
+#include <getopt.h>
+#include <iostream>
+#include <optional>
+#include <string>
 #include <sysexits.h>
-#include <unordered_set>
+#include <thread>
+#include <tuple>
+#include <type_traits>
 #include <vector>
 
+#include "astar.h"
+#include "level_bitmap.h"
+#include "solver.h"
+#include "thread_pool.h"
 #include "utils.h"
 
-using water = uint16_t; // Water level measurement
+namespace {
+
+constexpr unsigned MIN_VESSELS = 2;
+constexpr unsigned MAX_VESSELS = 6;
+
+/// The level types, narrowest first, an instance is solved with the first one all of its numbers fit in
+using Waters = std::tuple<uint8_t, uint16_t, uint32_t>;
+constexpr uint64_t MAX_NUMBER = type_max<std::tuple_element_t<std::tuple_size_v<Waters> - 1, Waters>>();
+
+const char *const USAGE = "Solve the water vessels, tap and sink problem, with 2 to 6 vessels.\n"
+                          "The volumes and the target are up to 4294967295, the levels are kept in 8, 16 or 32 bits,\n"
+                          "the fewest they fit in.\n\n"
+                          "Usage:\n"
+                          "\twater [OPTIONS] LIMIT_1 LIMIT_2 [LIMIT_3 ... LIMIT_6] TARGET\n"
+                          "\twater [OPTIONS] --all-targets LIMIT_1 LIMIT_2 [LIMIT_3 ... LIMIT_6]\n"
+                          "\twater [OPTIONS] --batch[=FILE]\n\n"
+                          "Options:\n"
+                          "\t--all-targets       Search once, print the shortest solution of every amount\n"
+                          "\t--astar             Search for the target by A* instead of breadth first, 3 vessels only\n"
+                          "\t--bitmap            Search a whole level at a time on bitmaps, for moderate volumes of 3\n"
+                          "\t                    vessels only\n"
+                          "\t--batch[=FILE]      Solve the 'LIMIT_1 ... LIMIT_N TARGET' lines of the file or stdin on\n"
+                          "\t                    all cores, print them with the steps (-1 if unsolvable) appended\n"
+                          "\t--layout=LAYOUT     Visited states storage: automatic, box, surface or sparse\n"
+                          "\t--tracking=TRACKING Solution path memory: parents, moves, depths (2 bits per state) or\n"
+                          "\t                    frontier (the least, the path is searched for again)\n"
+                          "\t--threads=COUNT     Threads expanding the big search levels or solving the batch, 0 for\n"
+                          "\t                    all cores, the default for --batch\n\n"
+                          "Example:\n\twater 3 5 8 4";
+
+/// Options of a single instance
+struct Options {
+    bool all_targets = false;
+    bool astar = false;
+    bool bitmap = false;
+    Layout layout = Layout::automatic;
+    Tracking tracking = Tracking::parents;
+    unsigned threads = 0; // Not set
+};
 
-template <typename T>
-constexpr T type_max() noexcept {
-    return std::numeric_limits<water>::max();
+/// Call `visit(std::integral_constant<unsigned, N>{})` with the vessel count N as a compile time constant, it must be
+/// in [MIN_VESSELS, MAX_VESSELS]
+template <unsigned N = MIN_VESSELS, typename Visit>
+auto with_vessels(size_t vessels, Visit &&visit) {
+    if constexpr (N < MAX_VESSELS) {
+        if (vessels != N) {
+            return with_vessels<N + 1>(vessels, std::forward<Visit>(visit));
+        }
+    }
+    assert(vessels == N);
+    return visit(std::integral_constant<unsigned, N>{});
 }
 
-/// Three water vessel's current contents in liters of water, the volumes must be kept in one more State variable.
-// Inherits comparison operators from std::array<T, S>()
-class VesselsState: public std::array<water, 3> {
-public:
-    constexpr VesselsState() noexcept: std::array<water, 3>({0, 0, 0}) {}
-    constexpr VesselsState(water a, water b, water c) noexcept: std::array<water, 3>({a, b, c}) {}
+/// Call `visit(std::type_identity<Water>{})` with the narrowest of the Waters the number fits in, it must fit in the
+/// widest
+template <size_t I = 0, typename Visit>
+auto with_water(uint64_t largest, Visit &&visit) {
+    using Water = std::tuple_element_t<I, Waters>;
+    if constexpr (I + 1 < std::tuple_size_v<Waters>) {
+        if (largest > type_max<Water>()) {
+            return with_water<I + 1>(largest, std::forward<Visit>(visit));
+        }
+    }
+    assert(largest <= type_max<Water>());
+    return visit(std::type_identity<Water>{});
+}
 
-    /// Hash for unordered containers, c++ 23 it can even be static (__cpp_static_call_operator, P1169R3)
-    constexpr size_t operator()(const VesselsState &state) const noexcept {
-        return (size_t(state[0]) * type_max<water>() + state[1]) * type_max<water>() + state[2];
-    };
+/// Parse the value of --layout, returns false if unknown
+bool parse_layout(const char *name, Layout &layout) {
+    if (strcmp(name, "automatic") == 0) {
+        layout = Layout::automatic;
+    } else if (strcmp(name, "box") == 0) {
+        layout = Layout::box;
+    } else if (strcmp(name, "surface") == 0) {
+        layout = Layout::surface;
+    } else if (strcmp(name, "sparse") == 0) {
+        layout = Layout::sparse;
+    } else {
+        return false;
+    }
+    return true;
+}
 
-    /// Return new state after transferring water
-    [[nodiscard]]
-    VesselsState transfer(unsigned src, unsigned dst, const VesselsState &volumes) const noexcept {
-        VesselsState result = *this; // copy
-        const water dst_free = volumes.at(dst) - this->at(dst);
-        if (this->at(src) <= dst_free) {
-            result.at(dst) += this->at(src);
-            result.at(src) = 0;
+/// Parse the value of --tracking, returns false if unknown
+bool parse_tracking(const char *name, Tracking &tracking) {
+    if (strcmp(name, "parents") == 0) {
+        tracking = Tracking::parents;
+    } else if (strcmp(name, "moves") == 0) {
+        tracking = Tracking::moves;
+    } else if (strcmp(name, "frontier") == 0) {
+        tracking = Tracking::frontier;
+    } else if (strcmp(name, "depths") == 0) {
+        tracking = Tracking::depths;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+/// Print the shortest solution of every amount, the steps and the state it ends with
+template <typename Solver, typename State>
+void show_all(Solver &solver, const State &volumes) {
+    using Table = BasicWaterPouringPuzzleSolver<State::VESSELS, typename State::Level>;
+    solver.solve_all();
+    fmt::print("Shortest solutions using {} vessels, {} states discovered\n", Table::listed(volumes),
+               solver.discovered());
+    const uint64_t biggest = *std::max_element(volumes.begin(), volumes.end());
+    int most_steps = 0;
+    for (uint64_t amount = 0; amount <= biggest; ++amount) {
+        most_steps = std::max(most_steps, solver.solution(static_cast<typename State::Level>(amount)).steps);
+    }
+    const size_t width = Table::column_width(volumes);
+    const size_t amount_width = std::max<size_t>(6, fmt::formatted_size("{}", biggest));
+    const size_t steps_width = std::max<size_t>(5, fmt::formatted_size("{}", most_steps));
+    const std::string amount_rule = Table::rule(amount_width + 2);
+    const std::string steps_rule = Table::rule(steps_width + 2);
+    Table::print_border("┌" + amount_rule + "┬" + steps_rule, "┬", "┐", width);
+    Table::print_row(fmt::format("│ {: >{}} │ {: >{}} ", "Amount", amount_width, "Steps", steps_width), volumes, width);
+    Table::print_border("├" + amount_rule + "┼" + steps_rule, "┼", "┤", width);
+    for (uint64_t amount = 0; amount <= biggest; ++amount) {
+        const auto solution = solver.solution(static_cast<typename State::Level>(amount));
+        if (solution.steps < 0) {
+            std::string line = fmt::format("│ {: >{}} │ {: >{}} ", amount, amount_width, "-", steps_width);
+            for (size_t vessel = 0; vessel != State::VESSELS; ++vessel) {
+                line += fmt::format("│ {: >{}} ", "", width);
+            }
+            fmt::print("{}│\n", line);
         } else {
-            result.at(dst) += dst_free;
-            result.at(src) -= dst_free;
+            Table::print_row(fmt::format("│ {: >{}} │ {: >{}} ", amount, amount_width, solution.steps, steps_width),
+                             solution.state, width);
         }
-        return result;
     }
+    Table::print_border("└" + amount_rule + "┴" + steps_rule, "┴", "┘", width);
+}
 
-    /// Calculate all possible next states
-    [[nodiscard]]
-    std::vector<VesselsState> next_states(const VesselsState &volumes) const {
-        std::vector<VesselsState> result;
-        result.reserve(12); // up to 12, use only 1 memory allocation
-
-        for (unsigned from = 0; from < 3; from++) {
-            // Fill (up to 3)
-            if (this->at(from) == 0) {
-                VesselsState new_state = *this;
-                new_state.at(from) = volumes.at(from);
-                result.push_back(new_state);
-            }
+/// Solve and print it by A*, with the states it expanded, returns the steps or -1
+int solve_astar(const VesselsState &volumes, water target) {
+    AStarSolver solver{volumes};
+    const int steps = solver.solve(target);
+    if (steps > 0) {
+        WaterPouringPuzzleSolver::print_path(volumes, target, solver.path());
+        fmt::print("{} states expanded, {} discovered\n", solver.expanded(), solver.discovered());
+    }
+    return steps;
+}
 
-            // Drain (up to 3)
-            if (this->at(from) != 0) {
-                VesselsState new_state = *this;
-                new_state.at(from) = 0;
-                result.push_back(new_state);
-            }
+/// Solve and print it by the level bitmaps, returns the steps or -1
+int solve_bitmap(const VesselsState &volumes, water target) {
+    LevelBitmapSolver solver{volumes};
+    const int steps = solver.solve(target);
+    if (steps > 0) {
+        WaterPouringPuzzleSolver::print_path(volumes, target, solver.path(solver.solution(target)));
+    }
+    return steps;
+}
 
-            // Transfer (up to 6)
-            for (unsigned to = 0; to < 3; to++) {
-                if (from != to && this->at(to) < volumes.at(to) && this->at(from) > 0) {
-                    result.push_back(transfer(from, to, volumes));
-                }
-            }
-        }
+/// The volumes of an instance and the target, the vessels beyond `vessels` are unused
+struct Numbers {
+    std::array<uint64_t, MAX_VESSELS + 1> values{};
+    size_t vessels = 0;
 
-        result.shrink_to_fit(); // And trim the unused part on the right (if any)
+    /// The volumes as the state of the instance's vessel count, they must fit in its levels
+    template <typename State>
+    [[nodiscard]]
+    State volumes() const noexcept {
+        State state;
+        std::transform(values.begin(), values.begin() + State::VESSELS, state.begin(),
+                       [](uint64_t volume) { return static_cast<typename State::Level>(volume); });
+        return state;
+    }
+
+    /// A copy with the volumes in ascending order, the same puzzle, instances differing in the order share a search
+    [[nodiscard]]
+    Numbers sorted() const noexcept {
+        Numbers result = *this;
+        const size_t count = std::min<size_t>(vessels, MAX_VESSELS); // Bounded, or GCC 12 warns of the sort's tail
+        std::sort(result.values.begin(), result.values.begin() + static_cast<ptrdiff_t>(count));
         return result;
     }
 
-    // Do we contain the specified volume of water in any vessel?
+    /// The biggest volume or the target, whichever is more
     [[nodiscard]]
-    constexpr bool contains(water volume) const noexcept {
-//        return std::find(this->begin(), this->end(), volume) != this->end(); // C++20
-        return this->at(0) == volume || this->at(1) == volume || this->at(2) == volume;
+    uint64_t largest() const noexcept {
+        return std::max(*std::max_element(values.begin(), values.begin() + static_cast<ptrdiff_t>(vessels)),
+                        values.back());
     }
 };
 
-// "Unit test" for C++20 and above
-#if __cplusplus >= 202002L
-static_assert(VesselsState{1, 2, 3} == VesselsState{1, 2, 3});
-static_assert(VesselsState{1, 2, 3} != VesselsState{2, 2, 3});
-static_assert(VesselsState{2, 2, 3} != VesselsState{1, 2, 3});
-static_assert(VesselsState{1, 2, 8} != VesselsState{1, 2, 3});
-static_assert(VesselsState{1, 2, 3} != VesselsState{1, 2, 8});
-static_assert(VesselsState{1, 2, 3} < VesselsState{1, 2, 4});
-static_assert(VesselsState{2, 2, 3} > VesselsState{1, 2, 4});
-#endif
-
-/// Solve the water pouring puzzle with tap, sink and empty initial state.
-class WaterPouringPuzzleSolver {
-    using History = std::vector<std::pair<VesselsState, int>>;
-    using Visited = std::unordered_set<VesselsState, VesselsState>;
-#if __cplusplus < 201703L
-    enum { INVALID_IDX = -1 };
-#else
-    constexpr inline static const int INVALID_IDX = -1;
-#endif
-
-protected:
-    VesselsState m_volumes;
-    History m_history{}; // State discovery history
-    Visited m_visited{}; // States visited
-
-public:
-    explicit WaterPouringPuzzleSolver(const VesselsState &volumes): m_volumes(volumes) {}
-
-    /// Returns in how many steps it can be solved (and prints it), -1 is no solution
-    int solve_water(const water target) {
-        if (target == 0) {
-            puts("All vessels are empty initially, all have 0 liters of water, 0 steps!");
-            return 0;
-        }
-
-        init(); // Allow the method to be called multiple times, optimize the number of memory allocations
-
-        m_visited.emplace(0, 0, 0);  // We don't want to empty all of them
-        m_visited.insert(m_volumes); // We also don't want to fill all of them
-
-        int step = 0;                                               // count steps
-        size_t old_ptr = 0;                                         // All elements [0 .. history.size()) are new
-        m_history.emplace_back(VesselsState{0, 0, 0}, INVALID_IDX); // Initial state
-
-        while (old_ptr != m_history.size()) {
-            ++step;
-
-            const size_t next_ptr = m_history.size();
-            for (size_t ptr = old_ptr; ptr < next_ptr; ++ptr) {
-                const VesselsState &old_state = m_history.at(ptr).first;
-
-                for (const VesselsState new_state : old_state.next_states(m_volumes)) {
-                    if (m_visited.find(new_state) != m_visited.end()) {
-                        continue;
-                    }
-                    m_visited.insert(new_state);
-                    m_history.emplace_back(new_state, ptr);
+/// Parse a volume or a target, at most MAX_NUMBER, returns false if there is none, `end` is set like by strtoll()
+bool parse_number(const char *text, char *&end, uint64_t &number) {
+    const long long result = strtoll(text, &end, 10);
+    if (end == text || result < 0 || static_cast<unsigned long long>(result) > MAX_NUMBER) {
+        return false;
+    }
+    number = static_cast<uint64_t>(result);
+    return true;
+}
 
-                    if (new_state.contains(target)) {
-                        show(target, step);
-                        return step;
-                    }
-                }
+/// Parse "LIMIT_1 ... LIMIT_N TARGET", returns false if the text is not MIN_VESSELS + 1 to MAX_VESSELS + 1 numbers
+bool parse_instance(const std::string &text, Numbers &numbers) {
+    const char *pos = text.c_str();
+    size_t count = 0;
+    while (true) {
+        char *end = nullptr;
+        uint64_t number = 0;
+        if (!parse_number(pos, end, number)) {
+            if (end == pos) {
+                break;
             }
+            return false;
+        }
+        if (count == numbers.values.size()) {
+            return false;
+        }
+        numbers.values.at(count++) = number;
+        pos = end;
+    }
+    while (*pos == ' ' || *pos == '\t' || *pos == '\r') {
+        ++pos;
+    }
+    if (*pos != '\0' || count < MIN_VESSELS + 1) {
+        return false;
+    }
+    numbers.vessels = count - 1;
+    std::swap(numbers.values.at(numbers.vessels), numbers.values.back()); // The target last
+    return true;
+}
+
+/// A solver per vessel count with the Water levels, created when first needed
+template <typename Water>
+using SolversOf = std::tuple<
+    std::optional<BasicWaterPouringPuzzleSolver<2, Water>>, std::optional<BasicWaterPouringPuzzleSolver<3, Water>>,
+    std::optional<BasicWaterPouringPuzzleSolver<4, Water>>, std::optional<BasicWaterPouringPuzzleSolver<5, Water>>,
+    std::optional<BasicWaterPouringPuzzleSolver<6, Water>>>;
+static_assert(std::tuple_size_v<SolversOf<water>> == MAX_VESSELS - MIN_VESSELS + 1);
+
+/// The solvers of every level type
+using Solvers = std::tuple<SolversOf<uint8_t>, SolversOf<uint16_t>, SolversOf<uint32_t>>;
+static_assert(std::tuple_size_v<Solvers> == std::tuple_size_v<Waters>);
+
+/// Solve the instances of the input lines in chunks on a pool of workers with a solver each, print them with the
+/// steps appended in the input order, the volumes as given. A worker keeps its search if the next instance has the same
+/// volumes, in any order.
+int run_batch(std::istream &input, unsigned threads, Layout layout, Tracking tracking) {
+    constexpr size_t CHUNK = 4096; // Lines read, solved and printed at a time
+    struct Instance {
+        Numbers numbers;
+        int steps;
+    };
 
-            old_ptr = next_ptr;
+    WorkStealingPool pool{threads};
+    std::vector<Solvers> solvers(pool.workers());
+    std::vector<Instance> instances;
+    instances.reserve(CHUNK);
+    int result = EX_OK;
+    size_t line_number = 0;
+    for (std::string line; input;) {
+        instances.clear();
+        while (instances.size() != CHUNK && std::getline(input, line)) {
+            ++line_number;
+            if (line.find_first_not_of(" \t\r") == std::string::npos || line[line.find_first_not_of(" \t")] == '#') {
+                continue; // Empty or a comment
+            }
+            Instance instance{};
+            if (!parse_instance(line, instance.numbers)) {
+                fmt::print(stderr, "Invalid instance (line {}): '{}'!\n", line_number, line);
+                result = EX_DATAERR;
+                continue;
+            }
+            instances.push_back(instance);
         }
 
-        return -1; // No new state transitions possible, no solution
+        pool.run(instances.size(), [&](unsigned worker, size_t index) {
+            Instance &instance = instances[index];
+            instance.steps = with_vessels(instance.numbers.vessels, [&](auto vessel_count) {
+                return with_water(instance.numbers.largest(), [&](auto water_type) {
+                    using Water = typename decltype(water_type)::type;
+                    using Solver = BasicWaterPouringPuzzleSolver<decltype(vessel_count)::value, Water>;
+                    const auto volumes = instance.numbers.sorted().volumes<typename Solver::State>();
+                    auto &solver = std::get<std::optional<Solver>>(std::get<SolversOf<Water>>(solvers[worker]));
+                    if (!solver) {
+                        solver.emplace(volumes, layout, tracking);
+                    } else if (solver->volumes() != volumes) {
+                        solver->reset(volumes);
+                    }
+                    return solver->solve(static_cast<Water>(instance.numbers.values.back()));
+                });
+            });
+        });
+
+        for (const Instance &instance : instances) {
+            std::string text;
+            for (size_t vessel = 0; vessel != instance.numbers.vessels; ++vessel) {
+                text += fmt::format("{} ", instance.numbers.values.at(vessel));
+            }
+            fmt::print("{}{} {}\n", text, instance.numbers.values.back(), instance.steps);
+        }
     }
+    return result;
+}
 
-protected:
-    void init() {
-        // Allow the method to be called multiple times
-        m_history.clear();
-        m_visited.clear();
-        // Save some memory allocations
-        m_history.reserve(256);
-        m_visited.reserve(256);
+/// Solve and print a single instance of N vessels with the Water levels
+template <unsigned N, typename Water>
+int run_instance(const Numbers &numbers, const Options &options) {
+    using Solver = BasicWaterPouringPuzzleSolver<N, Water>;
+    const auto volumes = numbers.volumes<typename Solver::State>();
+    const auto target = static_cast<Water>(numbers.values.back());
+
+    if constexpr (N == 3) { // A* and the level bitmaps keep the levels of VesselsState
+        if ((options.astar || options.bitmap) && numbers.largest() > type_max<water>()) {
+            fmt::print("Volumes too big for --{}!\n", options.astar ? "astar" : "bitmap");
+            return EX_USAGE;
+        }
+        if (options.bitmap && !LevelBitmapSolver::fits(numbers.volumes<VesselsState>())) {
+            fmt::print("Volumes too big for --bitmap!\n");
+            return EX_USAGE;
+        }
     }
 
-    /// Print the solution
-    void show(const water target, int steps) {
-        if (steps <= 0) {
-            return;
+    if (options.layout != Layout::automatic && Visited<typename Solver::State>::resolve(volumes, options.layout) !=
+                                                   options.layout) {
+        fmt::print(stderr, "Volumes too big for the --layout bitmap, using sparse!\n");
+    }
+    Solver solver{volumes, options.layout, options.tracking, std::max(options.threads, 1U)};
+    if constexpr (N == 3) {
+        if (options.all_targets && options.bitmap) {
+            LevelBitmapSolver levels{numbers.volumes<VesselsState>()};
+            show_all(levels, numbers.volumes<VesselsState>());
+            return EX_OK;
         }
-        assert(!m_history.empty());
+    }
+    if (options.all_targets) {
+        show_all(solver, volumes);
+        return EX_OK;
+    }
 
-        fmt::print("Solved measure {} liters of water using {}, {} and {} vessels in {} steps\n", target,
-                   m_volumes.at(0), m_volumes.at(1), m_volumes.at(2), steps);
-        fmt::print("┌──────┬─────┬─────┬─────┐\n");
-        fmt::print("│ Step │ {: >3} │ {: >3} │ {: >3} │\n", m_volumes.at(0), m_volumes.at(1), m_volumes.at(2));
-        fmt::print("├──────┼─────┼─────┼─────┤\n");
+    // Quick check, the same feasibility oracle the search starts with
+    fmt::print("The volumes indicate the puzzle is {}solvable!\n", Solver::measurable(volumes, target) ? "" : "un");
 
-        // If only the first solution is needed we can modify the history to reverse the index pointers and walk
-        // forward.
+    // Try to solve it
+    int steps = 0;
+    if constexpr (N == 3) {
+        if (options.astar && target != 0) {
+            steps = solve_astar(numbers.volumes<VesselsState>(), static_cast<water>(target));
+        } else if (options.bitmap && target != 0) {
+            steps = solve_bitmap(numbers.volumes<VesselsState>(), static_cast<water>(target));
+        } else {
+            steps = solver.solve_water(target);
+        }
+    } else {
+        steps = solver.solve_water(target);
+    }
+    if (steps < 0) {
+        puts("No solution found!");
+        return EX_UNAVAILABLE;
+    }
 
-        std::vector<int> solution;
-        solution.resize(static_cast<size_t>(steps) + 1);
+    return EX_OK;
+}
 
-        int history_idx = static_cast<int>(m_history.size() - 1);
-        for (int pos = steps; pos != -1; --pos) {
-            solution.at(static_cast<size_t>(pos)) = history_idx;                 // Save current
-            history_idx = m_history.at(static_cast<size_t>(history_idx)).second; // travel back
+} // namespace
 
-            if (pos == 0) {
-                assert(history_idx == -1);
-            } else {
-                assert(history_idx >= 0);
+int main(int argc, char *argv[]) {
+    Options options{};
+    bool batch = false;
+    const char *batch_file = nullptr; // stdin if not set
+
+    enum Option : int { ALL_TARGETS = 1, ASTAR, BATCH, BITMAP, LAYOUT, TRACKING, THREADS };
+    const std::array<option, 8> long_options{{{"all-targets", no_argument, nullptr, ALL_TARGETS},
+                                              {"astar", no_argument, nullptr, ASTAR},
+                                              {"batch", optional_argument, nullptr, BATCH},
+                                              {"bitmap", no_argument, nullptr, BITMAP},
+                                              {"layout", required_argument, nullptr, LAYOUT},
+                                              {"tracking", required_argument, nullptr, TRACKING},
+                                              {"threads", required_argument, nullptr, THREADS},
+                                              {nullptr, 0, nullptr, 0}}};
+    // The options come first, stop at the first number, a negative one too: it is an invalid number, not an option
+    const auto number_next = [&] { return optind < argc && argv[optind][0] == '-' && isdigit(argv[optind][1]) != 0; };
+    for (int opt = 0; !number_next() && (opt = getopt_long(argc, argv, "+", long_options.data(), nullptr)) != -1;) {
+        switch (opt) {
+        case ALL_TARGETS:
+            options.all_targets = true;
+            break;
+        case ASTAR:
+            options.astar = true;
+            break;
+        case BATCH:
+            batch = true;
+            batch_file = optarg;
+            break;
+        case BITMAP:
+            options.bitmap = true;
+            break;
+        case LAYOUT:
+            if (!parse_layout(optarg, options.layout)) {
+                fmt::print("Invalid layout: '{}'!\n", optarg);
+                return EX_USAGE;
             }
+            break;
+        case TRACKING:
+            if (!parse_tracking(optarg, options.tracking)) {
+                fmt::print("Invalid tracking: '{}'!\n", optarg);
+                return EX_USAGE;
+            }
+            break;
+        case THREADS: {
+            char *end = nullptr;
+            const unsigned long count = strtoul(optarg, &end, 10);
+            if (end == optarg || *end != '\0' || count > 1024) {
+                fmt::print("Invalid threads count: '{}'!\n", optarg);
+                return EX_USAGE;
+            }
+            const unsigned threads =
+                count == 0 ? std::max(std::thread::hardware_concurrency(), 1U) : static_cast<unsigned>(count);
+            options.threads = std::max(threads, 1U); // Set
+            break;
         }
-
-        for (int i = 0; i != steps + 1; ++i) {
-            const VesselsState &state = m_history.at(static_cast<size_t>(solution.at(static_cast<size_t>(i)))).first;
-            fmt::print("│ {: >3}. │ {: >3} │ {: >3} │ {: >3} │\n", i, state.at(0), state.at(1), state.at(2));
+        default:
+            puts(USAGE);
+            return EX_USAGE;
         }
-        fmt::print("└──────┴─────┴─────┴─────┘\n");
     }
-};
 
-int main(int argc, char *argv[]) {
-    if (argc != 5) {
-        puts("Solve the three water vessels, tap and sink problem.\n\n"
-             "Usage:\n\twater LIMIT_1 LIMIT_2 LIMIT_3 TARGET\n\n"
-             "Example:\n\twater 3 5 8 4");
+    if (batch) {
+        if (options.all_targets || options.astar || options.bitmap || argc != optind) {
+            puts(USAGE);
+            return EX_USAGE;
+        }
+        const unsigned threads =
+            options.threads == 0 ? std::max(std::thread::hardware_concurrency(), 1U) : options.threads;
+        if (batch_file == nullptr || strcmp(batch_file, "-") == 0) {
+            return run_batch(std::cin, threads, options.layout, options.tracking);
+        }
+        std::ifstream input(batch_file);
+        if (!input) {
+            fmt::print("Can not open '{}'!\n", batch_file);
+            return EX_NOINPUT;
+        }
+        return run_batch(input, threads, options.layout, options.tracking);
+    }
 
+    const auto count = static_cast<size_t>(argc - optind);
+    const size_t vessels = options.all_targets ? count : count - 1;
+    if (count == 0 || vessels < MIN_VESSELS || vessels > MAX_VESSELS ||
+        (options.astar && (options.all_targets || options.bitmap)) ||
+        ((options.astar || options.bitmap) && vessels != 3)) {
+        puts(USAGE);
         return EX_USAGE;
     }
 
-    VesselsState volumes{};
-    water target{};
-
-    { // Use some stack memory temporary
-        std::array<water, 5> numbers{};
-        for (int i = 1; i < 5; ++i) {
-            char *end = nullptr;
-            const long result = strtol(argv[i], &end, 10);
-            numbers[i] = static_cast<water>(result);
-            if (end == argv[i] || *end != '\0' || numbers[i] != result) {
-                fmt::print("Invalid number (argument {}): '{}'!\n", i, argv[i]);
-                return EX_DATAERR;
-            }
+    Numbers numbers{};
+    numbers.vessels = vessels;
+    for (size_t i = 0; i < count; ++i) {
+        const char *arg = argv[optind + static_cast<int>(i)];
+        char *end = nullptr;
+        uint64_t number = 0;
+        if (!parse_number(arg, end, number) || *end != '\0') {
+            fmt::print("Invalid number (argument {}): '{}'!\n", optind + static_cast<int>(i), arg);
+            return EX_DATAERR;
         }
-        std::sort(&numbers[1], &numbers[3]); // Not really needed
-        volumes = VesselsState(numbers[1], numbers[2], numbers[3]);
-        target = numbers[4];
-    }
-
-    // Quick check
-    const auto volume_gcd = gcd(volumes.at(0), volumes.at(1), volumes.at(2));
-    fmt::print("GCD indicates the puzzle is {}solvable!\n", (target % volume_gcd != 0 ? "un" : ""));
-
-    // Try to solve it
-    WaterPouringPuzzleSolver solver{volumes};
-    if (solver.solve_water(target) < 0) {
-        puts("No solution found!");
-        return EX_UNAVAILABLE;
+        numbers.values.at(i < vessels ? i : numbers.values.size() - 1) = number; // The target last
     }
 
-    return EX_OK;
+    return with_vessels(vessels, [&](auto vessel_count) {
+        return with_water(numbers.largest(), [&](auto water_type) {
+            return run_instance<decltype(vessel_count)::value, typename decltype(water_type)::type>(numbers, options);
+        });
+    });
 }